@@ -0,0 +1,349 @@
+#ifndef CUCKOOFILTER_BENCH_UTIL_H
+#define CUCKOOFILTER_BENCH_UTIL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "hash_function.hpp"
+
+
+/**
+ * Current time of the monotonic clock in nanoseconds.
+ */
+inline uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+/**
+ * Benchmark key number i. Keys are a bijection of their numbers, so keys with different numbers never
+ * collide, while consecutive numbers give unrelated keys.
+ *
+ * @param i Key number
+ * @param salt Distinguishes key sets of different runs
+ * @return Key
+ */
+inline uint64_t benchKey(uint64_t i, uint64_t salt) {
+    return mixHash(i + salt);
+}
+
+
+/**
+ * Zipfian distribution over ranks 0 to n-1, rank 0 being the most popular, generated as in YCSB
+ * (Gray et al., "Quickly generating billion-record synthetic databases").
+ */
+class ZipfGenerator {
+
+private:
+    size_t n_;
+    double theta_;
+    double alpha_;
+    double zetan_;
+    double eta_;
+
+public:
+
+    /**
+     * @param n Number of ranks
+     * @param theta Skew, between 0 (uniform) and 1 exclusive
+     */
+    ZipfGenerator(size_t n, double theta) : n_(n), theta_(theta) {
+        double zeta2 = 1 + pow(0.5, theta);
+        zetan_ = 0;
+        for (size_t i = 1; i <= n; i++) {
+            zetan_ += 1 / pow((double) i, theta);
+        }
+        alpha_ = 1 / (1 - theta);
+        eta_ = (1 - pow(2.0 / n, 1 - theta)) / (1 - zeta2 / zetan_);
+    }
+
+    /**
+     * @param u Uniform random number in [0, 1)
+     * @return Rank
+     */
+    size_t next(double u) const {
+        double uz = u * zetan_;
+        if (uz < 1) {
+            return 0;
+        }
+        if (uz < 1 + pow(0.5, theta_)) {
+            return 1;
+        }
+        size_t rank = (size_t) (n_ * pow(eta_ * u - eta_ + 1, alpha_));
+        return rank < n_ ? rank : n_ - 1;
+    }
+};
+
+
+/**
+ * Latency distribution of a sample, all values in nanoseconds.
+ */
+struct LatencySummary {
+    double mean = 0;
+    double p50 = 0;
+    double p90 = 0;
+    double p99 = 0;
+    double p999 = 0;
+    double max = 0;
+};
+
+
+/**
+ * Summarizing latency samples. Samples are sorted in place.
+ *
+ * @param samples Latency samples
+ * @return Mean, percentiles and maximum
+ */
+inline LatencySummary summarize(std::vector<double> &samples) {
+    LatencySummary summary;
+    if (samples.empty()) {
+        return summary;
+    }
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (double sample : samples) {
+        sum += sample;
+    }
+    size_t n = samples.size();
+    summary.mean = sum / n;
+    summary.p50 = samples[(size_t) (0.5 * (n - 1))];
+    summary.p90 = samples[(size_t) (0.9 * (n - 1))];
+    summary.p99 = samples[(size_t) (0.99 * (n - 1))];
+    summary.p999 = samples[(size_t) (0.999 * (n - 1))];
+    summary.max = samples[n - 1];
+    return summary;
+}
+
+
+/**
+ * Quantile of the standard normal distribution, found by bisection of erfc.
+ *
+ * @param p Probability between 0 and 1 exclusive
+ * @return z with P(Z < z) = p
+ */
+inline double normalQuantile(double p) {
+    double low = -40, high = 40;
+    for (int k = 0; k < 200; k++) {
+        double mid = (low + high) / 2;
+        if (0.5 * erfc(-mid / sqrt(2.0)) < p) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return (low + high) / 2;
+}
+
+
+/**
+ * Wilson score interval of a binomial proportion, which stays valid for proportions close to zero,
+ * unlike the normal approximation.
+ *
+ * @param successes Number of successes
+ * @param trials Number of trials
+ * @param confidence Confidence level, e.g. 0.95
+ * @return Lower and upper bound of the interval
+ */
+inline std::pair<double, double> wilsonInterval(size_t successes, size_t trials, double confidence) {
+    if (trials == 0) {
+        return std::make_pair(0.0, 1.0);
+    }
+    const double z = normalQuantile(0.5 + confidence / 2);
+    const double n = trials;
+    const double p = successes / n;
+    const double center = (p + z * z / (2 * n)) / (1 + z * z / n);
+    const double half = z / (1 + z * z / n) * sqrt(p * (1 - p) / n + z * z / (4 * n * n));
+    return std::make_pair(std::max(0.0, center - half), std::min(1.0, center + half));
+}
+
+
+/**
+ * One result line, an ordered list of named values.
+ */
+class Record {
+
+private:
+    std::vector<std::pair<std::string, std::string>> fields_;
+
+public:
+
+    Record &add(const std::string &name, const std::string &value) {
+        fields_.emplace_back(name, value);
+        return *this;
+    }
+
+    Record &add(const std::string &name, const char *value) {
+        return add(name, std::string(value));
+    }
+
+    template<typename T>
+    Record &add(const std::string &name, const T value) {
+        std::ostringstream out;
+        out << std::setprecision(6) << value;
+        return add(name, out.str());
+    }
+
+    Record &add(const std::string &name, const LatencySummary &summary) {
+        add(name + "_mean_ns", summary.mean);
+        add(name + "_p50_ns", summary.p50);
+        add(name + "_p90_ns", summary.p90);
+        add(name + "_p99_ns", summary.p99);
+        add(name + "_p999_ns", summary.p999);
+        return add(name + "_max_ns", summary.max);
+    }
+
+    const std::vector<std::pair<std::string, std::string>> &fields() const {
+        return fields_;
+    }
+};
+
+
+/**
+ * Writing records as CSV, one header line per change of columns, or as a JSON array.
+ */
+class ResultWriter {
+
+private:
+    std::ostream &out_;
+    bool json_;
+    size_t written_;
+    std::vector<std::string> header_;
+
+    static bool isNumber(const std::string &value) {
+        if (value.empty()) {
+            return false;
+        }
+        char *end;
+        strtod(value.c_str(), &end);
+        return *end == '\0';
+    }
+
+public:
+
+    /**
+     * @param out Output stream
+     * @param json True for JSON, false for CSV
+     */
+    ResultWriter(std::ostream &out, bool json) : out_(out), json_(json), written_(0) {
+        if (json_) {
+            out_ << "[\n";
+        }
+    }
+
+    ~ResultWriter() {
+        if (json_) {
+            out_ << "\n]\n";
+        }
+        out_.flush();
+    }
+
+    void write(const Record &record) {
+        const auto &fields = record.fields();
+        if (json_) {
+            out_ << (written_ ? ",\n" : "") << "  {";
+            for (size_t k = 0; k < fields.size(); k++) {
+                out_ << (k ? ", " : "") << "\"" << fields[k].first << "\": ";
+                if (isNumber(fields[k].second)) {
+                    out_ << fields[k].second;
+                } else {
+                    out_ << "\"" << fields[k].second << "\"";
+                }
+            }
+            out_ << "}";
+        } else {
+            std::vector<std::string> header;
+            for (const auto &field : fields) {
+                header.push_back(field.first);
+            }
+            if (header != header_) {
+                header_ = header;
+                for (size_t k = 0; k < header.size(); k++) {
+                    out_ << (k ? "," : "") << header[k];
+                }
+                out_ << "\n";
+            }
+            for (size_t k = 0; k < fields.size(); k++) {
+                out_ << (k ? "," : "") << fields[k].second;
+            }
+            out_ << "\n";
+        }
+        out_.flush();
+        written_++;
+    }
+};
+
+
+/**
+ * Splitting comma separated list, e.g. "uniform,zipf".
+ *
+ * @param text List
+ * @return Non-empty items
+ */
+inline std::vector<std::string> splitList(const std::string &text) {
+    std::vector<std::string> items;
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+
+/**
+ * Parsing comma separated list of numbers, e.g. "0.5,0.9,0.95".
+ *
+ * @param text List
+ * @return Parsed values
+ */
+template<typename T>
+std::vector<T> parseList(const std::string &text) {
+    std::vector<T> values;
+    for (const std::string &item : splitList(text)) {
+        values.push_back((T) strtod(item.c_str(), nullptr));
+    }
+    return values;
+}
+
+
+/**
+ * Parsing size with optional K, M or G binary suffix, e.g. "32K" or "4G".
+ *
+ * @param text Size
+ * @return Size in bytes
+ */
+inline size_t parseBytes(const std::string &text) {
+    char *end;
+    double value = strtod(text.c_str(), &end);
+    switch (*end) {
+        case 'k':
+        case 'K':
+            value *= 1ULL << 10;
+            break;
+        case 'm':
+        case 'M':
+            value *= 1ULL << 20;
+            break;
+        case 'g':
+        case 'G':
+            value *= 1ULL << 30;
+            break;
+        default:
+            break;
+    }
+    return (size_t) value;
+}
+
+#endif
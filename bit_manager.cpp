@@ -10,10 +10,40 @@
  */
 template<typename fp_type>
 bool BitManager4<fp_type>::hasvalue(uint64_t value, uint32_t fp) {
+    return BitManager4<fp_type>::matchMask(value, fp) != 0;
+}
+
+/**
+ * Marking 4-bit entries of 64-bit value which are equal to fp. The lowest set bit is the highest bit of
+ * the first matching entry, bits above it may also be set by borrows and do not mark matches.
+ *
+ * @tparam fp_type Fingerprint type
+ * @param value 64-bit value
+ * @param fp Fingerprint for matching, 0 matches free entries
+ * @return Match mask, 0 if no entry matches
+ */
+template<typename fp_type>
+uint64_t BitManager4<fp_type>::matchMask(uint64_t value, uint32_t fp) {
     uint64_t neg = value ^(0x1111ULL * fp);
     return (neg - 0x1111ULL) & (~neg) & 0x8888ULL;
 }
 
+/**
+ * Marking 4-bit entries of 64-bit value whose bits under fp_mask are equal to fp, the other bits of an entry
+ * carry a payload and are ignored. Borrows may set bits above the first match like in matchMask.
+ *
+ * @tparam fp_type Fingerprint type
+ * @param value 64-bit value
+ * @param fp Fingerprint for matching, bits outside of fp_mask must be 0
+ * @param fp_mask Mask of fingerprint bits within an entry
+ * @return Match mask, 0 if no entry matches
+ */
+template<typename fp_type>
+uint64_t BitManager4<fp_type>::matchMask(uint64_t value, uint32_t fp, uint32_t fp_mask) {
+    uint64_t neg = (value ^ (0x1111ULL * fp)) & (0x1111ULL * fp_mask);
+    return (neg - 0x1111ULL) & (~neg) & 0x8888ULL;
+}
+
 /**
  * Reading the bitwise content of fp_type from memory location *p and 4-bit offset pos.
  *
@@ -52,16 +82,46 @@ void BitManager4<fp_type>::write(size_t pos, const uint8_t *p, uint32_t fp) {
  * Checking if fingerprint 4-bit fp is bitwise contained in 64-bit value.
  *
  * @tparam fp_type Fingerprint type
- * @param value 8-bit value
+ * @param value 64-bit value
  * @param fp Fingerprint for checking
  * @return True if value contains fingerprint, False otherwise
  */
 template<typename fp_type>
 bool BitManager8<fp_type>::hasvalue(uint64_t value, uint32_t fp) {
+    return BitManager8<fp_type>::matchMask(value, fp) != 0;
+}
+
+/**
+ * Marking 8-bit entries of 64-bit value which are equal to fp. The lowest set bit is the highest bit of
+ * the first matching entry, bits above it may also be set by borrows and do not mark matches.
+ *
+ * @tparam fp_type Fingerprint type
+ * @param value 64-bit value
+ * @param fp Fingerprint for matching, 0 matches free entries
+ * @return Match mask, 0 if no entry matches
+ */
+template<typename fp_type>
+uint64_t BitManager8<fp_type>::matchMask(uint64_t value, uint32_t fp) {
     uint64_t neg = value ^(0x01010101ULL * fp);
     return (neg - 0x01010101ULL) & (~neg) & 0x80808080ULL;
 }
 
+/**
+ * Marking 8-bit entries of 64-bit value whose bits under fp_mask are equal to fp, the other bits of an entry
+ * carry a payload and are ignored. Borrows may set bits above the first match like in matchMask.
+ *
+ * @tparam fp_type Fingerprint type
+ * @param value 64-bit value
+ * @param fp Fingerprint for matching, bits outside of fp_mask must be 0
+ * @param fp_mask Mask of fingerprint bits within an entry
+ * @return Match mask, 0 if no entry matches
+ */
+template<typename fp_type>
+uint64_t BitManager8<fp_type>::matchMask(uint64_t value, uint32_t fp, uint32_t fp_mask) {
+    uint64_t neg = (value ^ (0x01010101ULL * fp)) & (0x01010101ULL * fp_mask);
+    return (neg - 0x01010101ULL) & (~neg) & 0x80808080ULL;
+}
+
 
 /**
  * Reading the bitwise content of fp_type from memory location *p and 8-bit offset pos.
@@ -101,10 +161,40 @@ void BitManager8<fp_type>::write(size_t pos, const uint8_t *p, uint32_t fp) {
  */
 template<typename fp_type>
 bool BitManager12<fp_type>::hasvalue(uint64_t value, uint32_t fp) {
+    return BitManager12<fp_type>::matchMask(value, fp) != 0;
+}
+
+/**
+ * Marking 12-bit entries of 64-bit value which are equal to fp. The lowest set bit is the highest bit of
+ * the first matching entry, bits above it may also be set by borrows and do not mark matches.
+ *
+ * @tparam fp_type Fingerprint type
+ * @param value 64-bit value
+ * @param fp Fingerprint for matching, 0 matches free entries
+ * @return Match mask, 0 if no entry matches
+ */
+template<typename fp_type>
+uint64_t BitManager12<fp_type>::matchMask(uint64_t value, uint32_t fp) {
     uint64_t neg = value ^(0x001001001001ULL * (fp));
     return (neg - 0x001001001001ULL) & (~neg) & 0x800800800800ULL;
 }
 
+/**
+ * Marking 12-bit entries of 64-bit value whose bits under fp_mask are equal to fp, the other bits of an entry
+ * carry a payload and are ignored. Borrows may set bits above the first match like in matchMask.
+ *
+ * @tparam fp_type Fingerprint type
+ * @param value 64-bit value
+ * @param fp Fingerprint for matching, bits outside of fp_mask must be 0
+ * @param fp_mask Mask of fingerprint bits within an entry
+ * @return Match mask, 0 if no entry matches
+ */
+template<typename fp_type>
+uint64_t BitManager12<fp_type>::matchMask(uint64_t value, uint32_t fp, uint32_t fp_mask) {
+    uint64_t neg = (value ^ (0x001001001001ULL * fp)) & (0x001001001001ULL * fp_mask);
+    return (neg - 0x001001001001ULL) & (~neg) & 0x800800800800ULL;
+}
+
 
 /**
  * Reading the bitwise content of fp_type from memory location *p and 12-bit offset pos.
@@ -150,10 +240,40 @@ void BitManager12<fp_type>::write(size_t pos, const uint8_t *p, uint32_t fp) {
  */
 template<typename fp_type>
 bool BitManager16<fp_type>::hasvalue(uint64_t value, uint32_t fp) {
+    return BitManager16<fp_type>::matchMask(value, fp) != 0;
+}
+
+/**
+ * Marking 16-bit entries of 64-bit value which are equal to fp. The lowest set bit is the highest bit of
+ * the first matching entry, bits above it may also be set by borrows and do not mark matches.
+ *
+ * @tparam fp_type Fingerprint type
+ * @param value 64-bit value
+ * @param fp Fingerprint for matching, 0 matches free entries
+ * @return Match mask, 0 if no entry matches
+ */
+template<typename fp_type>
+uint64_t BitManager16<fp_type>::matchMask(uint64_t value, uint32_t fp) {
     uint64_t neg = value ^(0x0001000100010001ULL * (fp));
     return (neg - 0x0001000100010001ULL) & (~neg) & 0x8000800080008000ULL;
 }
 
+/**
+ * Marking 16-bit entries of 64-bit value whose bits under fp_mask are equal to fp, the other bits of an entry
+ * carry a payload and are ignored. Borrows may set bits above the first match like in matchMask.
+ *
+ * @tparam fp_type Fingerprint type
+ * @param value 64-bit value
+ * @param fp Fingerprint for matching, bits outside of fp_mask must be 0
+ * @param fp_mask Mask of fingerprint bits within an entry
+ * @return Match mask, 0 if no entry matches
+ */
+template<typename fp_type>
+uint64_t BitManager16<fp_type>::matchMask(uint64_t value, uint32_t fp, uint32_t fp_mask) {
+    uint64_t neg = (value ^ (0x0001000100010001ULL * fp)) & (0x0001000100010001ULL * fp_mask);
+    return (neg - 0x0001000100010001ULL) & (~neg) & 0x8000800080008000ULL;
+}
+
 
 /**
  * Reading the bitwise content of fp_type from memory location *p and 16-bit offset pos.
@@ -185,10 +305,40 @@ void BitManager16<fp_type>::write(size_t pos, const uint8_t *p, uint32_t fp) {
  */
 template<typename fp_type>
 bool BitManager32<fp_type>::hasvalue(uint64_t value, uint32_t fp) {
+    return BitManager32<fp_type>::matchMask(value, fp) != 0;
+}
+
+/**
+ * Marking 32-bit entries of 64-bit value which are equal to fp. The lowest set bit is the highest bit of
+ * the first matching entry, bits above it may also be set by borrows and do not mark matches.
+ *
+ * @tparam fp_type Fingerprint type
+ * @param value 64-bit value
+ * @param fp Fingerprint for matching, 0 matches free entries
+ * @return Match mask, 0 if no entry matches
+ */
+template<typename fp_type>
+uint64_t BitManager32<fp_type>::matchMask(uint64_t value, uint32_t fp) {
     uint64_t neg = value ^(0x0000000100000001ULL * (fp));
     return (neg - 0x0000000100000001ULL) & (~neg) & 0x8000000080000000ULL;
 }
 
+/**
+ * Marking 32-bit entries of 64-bit value whose bits under fp_mask are equal to fp, the other bits of an entry
+ * carry a payload and are ignored. Borrows may set bits above the first match like in matchMask.
+ *
+ * @tparam fp_type Fingerprint type
+ * @param value 64-bit value
+ * @param fp Fingerprint for matching, bits outside of fp_mask must be 0
+ * @param fp_mask Mask of fingerprint bits within an entry
+ * @return Match mask, 0 if no entry matches
+ */
+template<typename fp_type>
+uint64_t BitManager32<fp_type>::matchMask(uint64_t value, uint32_t fp, uint32_t fp_mask) {
+    uint64_t neg = (value ^ (0x0000000100000001ULL * fp)) & (0x0000000100000001ULL * fp_mask);
+    return (neg - 0x0000000100000001ULL) & (~neg) & 0x8000000080000000ULL;
+}
+
 
 /**
  * Reading the bitwise content of fp_type from memory location *p and 32-bit offset pos.
@@ -14,6 +14,10 @@ class BitManager {
 public:
     virtual bool hasvalue(uint64_t value, uint32_t fp) = 0;
 
+    virtual uint64_t matchMask(uint64_t value, uint32_t fp) = 0;
+
+    virtual uint64_t matchMask(uint64_t value, uint32_t fp, uint32_t fp_mask) = 0;
+
     virtual uint32_t read(size_t pos, const uint8_t *p) = 0;
 
     virtual void write(size_t pos, const uint8_t *p, uint32_t fp) = 0;
@@ -28,6 +32,10 @@ class BitManager4 : public BitManager<fp_type> {
 public:
     bool hasvalue(uint64_t value, uint32_t fp);
 
+    uint64_t matchMask(uint64_t value, uint32_t fp);
+
+    uint64_t matchMask(uint64_t value, uint32_t fp, uint32_t fp_mask);
+
     uint32_t read(size_t pos, const uint8_t *p);
 
     void write(size_t pos, const uint8_t *p, uint32_t fp);
@@ -42,6 +50,10 @@ class BitManager8 : public BitManager<fp_type> {
 public:
     bool hasvalue(uint64_t value, uint32_t fp);
 
+    uint64_t matchMask(uint64_t value, uint32_t fp);
+
+    uint64_t matchMask(uint64_t value, uint32_t fp, uint32_t fp_mask);
+
     uint32_t read(size_t pos, const uint8_t *p);
 
     void write(size_t pos, const uint8_t *p, uint32_t fp);
@@ -58,6 +70,10 @@ public:
 
     bool hasvalue(uint64_t value, uint32_t fp);
 
+    uint64_t matchMask(uint64_t value, uint32_t fp);
+
+    uint64_t matchMask(uint64_t value, uint32_t fp, uint32_t fp_mask);
+
     uint32_t read(size_t pos, const uint8_t *p);
 
     void write(size_t pos, const uint8_t *p, uint32_t fp);
@@ -73,6 +89,10 @@ public:
 
     bool hasvalue(uint64_t value, uint32_t fp);
 
+    uint64_t matchMask(uint64_t value, uint32_t fp);
+
+    uint64_t matchMask(uint64_t value, uint32_t fp, uint32_t fp_mask);
+
     uint32_t read(size_t pos, const uint8_t *p);
 
     void write(size_t pos, const uint8_t *p, uint32_t fp);
@@ -87,6 +107,10 @@ class BitManager32 : public BitManager<fp_type> {
 public:
     bool hasvalue(uint64_t value, uint32_t fp);
 
+    uint64_t matchMask(uint64_t value, uint32_t fp);
+
+    uint64_t matchMask(uint64_t value, uint32_t fp, uint32_t fp_mask);
+
     uint32_t read(size_t pos, const uint8_t *p);
 
     void write(size_t pos, const uint8_t *p, uint32_t fp);
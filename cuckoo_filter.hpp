@@ -1,9 +1,245 @@
+#ifndef CUCKOOFILTER_CUCKOO_FILTER_H
+#define CUCKOOFILTER_CUCKOO_FILTER_H
+
 #include <type_traits>
+#include <stdexcept>
+#include <string>
+#include <functional>
+#include <algorithm>
+#include <thread>
+#include <vector>
 #include "cuckoo_table.hpp"
+#include "filter_delta.hpp"
 #include "hash_function.hpp"
+#include "index_policy.hpp"
+#include "static_filter.hpp"
 #include "util.h"
+#include "victim_stash.hpp"
+#include "cuckoo_stats.hpp"
 
 #define KICKS_MAX_COUNT 500
+// number of operations whose buckets are prefetched together in batched calls
+#define BATCH_SIZE 16
+
+
+/**
+ * Outcome of inserting an element into Cuckoo Filter.
+ */
+enum class InsertStatus {
+    // fingerprint is stored in the table
+    Inserted,
+    // fingerprint was already contained, nothing is stored
+    AlreadyPresent,
+    // kick chain failed, fingerprint is kept in the stash
+    Stashed,
+    // stash is full or admission hook rejected the element, nothing is stored
+    RejectedFull
+};
+
+
+/**
+ * Snapshot of filter occupancy, passed to the admission hook.
+ */
+struct FilterLoad {
+    // number of fingerprints stored in the table
+    size_t element_count;
+    // maximum number of fingerprints stored in the table
+    size_t capacity;
+    // number of stashed fingerprints
+    size_t stash_size;
+    // maximum number of stashed fingerprints
+    size_t stash_capacity;
+    // element_count / capacity
+    double load_factor;
+};
+
+
+/**
+ * How containsElement reaches the secondary bucket.
+ */
+enum class LookupMode {
+    // secondary bucket is calculated and loaded only if the primary one misses, least memory traffic
+    // when most lookups hit the primary bucket
+    Sequential,
+    // secondary bucket is prefetched before the primary one is probed, so misses of both buckets overlap;
+    // faster when most lookups are negative and touch both buckets anyway
+    Speculative
+};
+
+
+/**
+ * Lookup started by beginLookup, both candidate buckets are being prefetched until endLookup probes them.
+ */
+struct LookupProbe {
+    uint32_t fp;
+    size_t i1;
+    size_t i2;
+};
+
+
+/**
+ * Called when both candidate buckets of a new element are full, before any fingerprint is kicked.
+ * Returning false rejects the element, so callers can grow or shed load instead of paying for a
+ * long kick chain.
+ */
+typedef std::function<bool(const FilterLoad &)> AdmissionHook;
+
+
+/**
+ * Projection of table entries which hold nothing but a fingerprint, used by CuckooFilter.
+ */
+struct PlainEntry {
+    inline static uint32_t fingerprint(uint32_t entry) {
+        return entry;
+    }
+};
+
+
+/**
+ * Kick chain, stash drain and deletion over a table with a victim stash, shared by CuckooFilter and the
+ * filters storing more than a fingerprint in an entry, e.g. PayloadFilter. Entries are kicked and stashed
+ * whole, alternate buckets are chosen by projection::fingerprint(entry), so an entry keeps its candidate
+ * buckets whatever else it holds. A chain refers to members of its filter and is created on demand.
+ *
+ * @tparam table_type CuckooTable storing the entries
+ * @tparam index_policy Mapping of fingerprints to alternate buckets
+ * @tparam projection Type with static uint32_t fingerprint(uint32_t entry), e.g. PlainEntry or PayloadCodec
+ */
+template<typename table_type, typename index_policy, typename projection>
+struct KickChain {
+    table_type &table;
+    const index_policy &policy;
+    VictimStash &stash;
+    // element count of the filter, stashed entries are not regarded as a part of the table
+    size_t &element_count;
+
+    /**
+     * @param index Previously calculated index
+     * @param entry Table entry
+     * @return Secondary index calculated from fingerprint of entry and previous index
+     */
+    inline size_t alternate(size_t index, uint32_t entry) const;
+
+    /**
+     * Insertion of entry on position index. Both candidate buckets are checked for a free entry before
+     * kicking starts. Maximum tries are defined with KICKS_MAX_COUNT constant. If the kick chain fails, the
+     * last kicked entry is stashed.
+     *
+     * @param entry Entry for insertion
+     * @param index Position for insertion
+     * @param record True if kicks are recorded by statistics, false for entries moved within the filter
+     * @param probe Called as probe(kicks, index) before bucket index is probed, false rejects the entry
+     * @return Inserted, Stashed, or RejectedFull if probe rejected the entry
+     */
+    template<typename probe_type>
+    InsertStatus insert(uint32_t entry, size_t index, bool record, probe_type probe);
+
+    /**
+     * Moving a stashed entry back to the table after a slot in bucket index is freed. A stashed entry which
+     * can use the freed slot directly is preferred, otherwise, if retry is set, the most recently stashed
+     * entry is reinserted with kicking.
+     *
+     * @param index Index of bucket with a freed slot
+     * @param retry True if an entry is reinserted when none can use the freed slot
+     */
+    void drainStash(size_t index, bool retry);
+
+    /**
+     * Deleting entry from bucket i1 or i2, or from the stash if neither holds it. A slot freed in the table
+     * is offered to the stash.
+     *
+     * @param entry Entry for deletion, matched exactly
+     * @return True if entry is deleted
+     */
+    bool remove(uint32_t entry, size_t i1, size_t i2);
+};
+
+
+template<typename table_type, typename index_policy, typename projection>
+size_t KickChain<table_type, index_policy, projection>::alternate(const size_t index, const uint32_t entry) const {
+    return policy.alternate(index, projection::fingerprint(entry));
+}
+
+
+template<typename table_type, typename index_policy, typename projection>
+template<typename probe_type>
+InsertStatus
+KickChain<table_type, index_policy, projection>::insert(uint32_t entry, size_t index, const bool record,
+                                                        probe_type probe) {
+    size_t curr_index = index;
+    uint32_t curr_entry = entry;
+    uint32_t prev_entry;
+
+    for (int kicks = 0; kicks < KICKS_MAX_COUNT; kicks++) {
+        if (!probe(kicks, curr_index)) {
+            CF_STATS(if (record) StatsRegistry::local().rejected++);
+            return InsertStatus::RejectedFull;
+        }
+        // first two tries probe both candidate buckets for a free entry
+        bool eject = (kicks > 1);
+        prev_entry = 0;
+        if (table.replacingFingerprintInsertion(curr_index, curr_entry, eject, prev_entry)) {
+            element_count++;
+            CF_STATS(if (record) StatsRegistry::local().recordKicks(eject ? kicks - 2 : 0));
+            return InsertStatus::Inserted;
+        }
+        if (eject) {
+            // the kicked entry keeps whatever it holds besides its fingerprint
+            curr_entry = prev_entry;
+        }
+        curr_index = alternate(curr_index, curr_entry);
+    }
+
+    stash.push(curr_entry, curr_index);
+    CF_STATS(if (record) StatsRegistry::local().stashed++);
+    CF_STATS(if (record) StatsRegistry::local().recordKicks(KICKS_MAX_COUNT - 2));
+    return InsertStatus::Stashed;
+}
+
+
+template<typename table_type, typename index_policy, typename projection>
+void KickChain<table_type, index_policy, projection>::drainStash(const size_t index, const bool retry) {
+    uint32_t prev_entry;
+
+    for (size_t k = 0; k < stash.size(); k++) {
+        Victim victim = stash.get(k);
+        if (victim.index == index || alternate(victim.index, victim.fp) == index) {
+            stash.removeAt(k);
+            table.replacingFingerprintInsertion(index, victim.fp, false, prev_entry);
+            element_count++;
+            CF_STATS(StatsRegistry::local().stash_drains++);
+            return;
+        }
+    }
+
+    if (!retry) {
+        return;
+    }
+    Victim victim = stash.pop();
+    if (insert(victim.fp, victim.index, false, [](int, size_t) { return true; }) == InsertStatus::Inserted) {
+        CF_STATS(StatsRegistry::local().stash_drains++);
+    }
+}
+
+
+template<typename table_type, typename index_policy, typename projection>
+bool KickChain<table_type, index_policy, projection>::remove(const uint32_t entry, const size_t i1, const size_t i2) {
+    size_t freed;
+
+    if (!table.deleteFingerprint(entry, i1, i2, freed)) {
+        // element count remains unmodified, stashed elements are not regarded as a part of the table
+        bool removed = !stash.empty() && stash.remove(entry, i1, i2);
+        CF_STATS(StatsRegistry::local().deletion_hits += removed);
+        return removed;
+    }
+    element_count--;
+    CF_STATS(StatsRegistry::local().deletion_hits++);
+
+    if (!stash.empty()) {
+        drainStash(freed, true);
+    }
+    return true;
+}
 
 
 /**
@@ -18,8 +254,15 @@
  * @tparam entries_per_bucket Number of entries in bucket
  * @tparam bits_per_fp  Number of bits in fingerprint
  * @tparam fp_type Fingerprint type
+ * @tparam hasher_type Functor mapping keys to 64-bit hash values, see KeyHash
+ * @tparam index_policy Mapping of hash values and fingerprints to buckets, XorIndexPolicy rounds the table
+ *                      down to a power of two, ModularIndexPolicy supports any number of buckets
+ *
+ * Compiled with -DCUCKOO_FILTER_STATS, every operation updates per-thread FilterStats counters,
+ * aggregated by StatsRegistry::instance().collect().
  */
-template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type = TransparentKeyHash, typename index_policy = XorIndexPolicy>
 class CuckooFilter {
 
 private:
@@ -29,14 +272,26 @@ private:
     // table for storing elements' fingerprints
     CuckooTable<entries_per_bucket, bits_per_fp, fp_type> *table_;
 
-    // number of stored elements
+    // maps hash values and fingerprints to buckets
+    index_policy index_policy_;
+
+    // number of stored elements, maintained by every insertion and deletion
     size_t element_count_;
 
     // used for calculating hash values
-    HashFunction *hash_function_;
+    HashFunction<hasher_type> *hash_function_;
+
+    // fingerprints whose kick chain failed
+    VictimStash stash_;
 
-    // helper structure
-    Victim victim_;
+    // decides whether kicking starts for a new element, may be empty
+    AdmissionHook admission_hook_;
+
+    // whether lookups prefetch the secondary bucket before probing the primary one
+    LookupMode lookup_mode_;
+
+    // sequence number of the last extracted delta, or of the last applied one on a replica
+    uint64_t sequence_;
 
     /**
      * Gets index from previously calculated hash value.
@@ -58,15 +313,15 @@ private:
      * Method for calculating first index and fingerprint from element hash value.
      * Both arguments should be accessed by reference.
      *
-     * @param item Item to store in filter
+     * @param hash_value 64-bit hash value of the element
      * @param fp Fingerprint pointer
      * @param index Index pointer
      */
-    inline void firstPass(const element_type &item, uint32_t *fp, size_t *index) const;
+    inline void firstPass(uint64_t hash_value, uint32_t *fp, size_t *index) const;
 
     /**
-     * Calculating second index from previous index and calculated fingerprint
-     *  $i2 = i1 \oplus hash(f)$\;
+     * Calculating second index from previous index and calculated fingerprint, e.g.
+     *  $i2 = i1 \oplus hash(f)$\; with XorIndexPolicy
      *
      * @param index Previously calculated index
      * @param fp Element fingerprint
@@ -75,14 +330,36 @@ private:
     inline uint32_t indexComplement(const size_t index, const uint32_t fp) const;
 
     /**
-     * Insertion of fingerprint fp on position index. Maximum tries are defined with KICKS_MAX_COUNT
-     * constant.
+     * @return Kick chain over the table and stash of this filter
+     */
+    inline KickChain<CuckooTable<entries_per_bucket, bits_per_fp, fp_type>, index_policy, PlainEntry> chain();
+
+    /**
+     * Insertion of fingerprint fp on position index with kicking, see KickChain::insert.
      *
      * @param fp Fingerprint for insertion
      * @param index Position for insertion
-     * @return True if element is inserted, false otherwise, or if item is kicked
+     * @param admit True if admission hook is consulted before kicking
+     * @return Inserted, Stashed, or RejectedFull if admission hook rejected the fingerprint
+     */
+    InsertStatus insert(uint32_t fp, size_t index, bool admit);
+
+    /**
+     * Checking that fingerprints of other can be merged by their bucket positions.
+     *
+     * @throws std::runtime_error if other is this filter or has a different seed or table size
      */
-    bool insert(uint32_t fp, size_t index);
+    void checkMergeable(const CuckooFilter &other) const;
+
+    /**
+     * Storing fingerprint fp of another filter which it kept in bucket index, kicking like insert does.
+     *
+     * @param fp Fingerprint for insertion
+     * @param index Bucket holding the fingerprint in the other filter
+     * @param skip_present If true, fingerprint contained in one of its candidate buckets is not stored again
+     * @return Outcome of the insertion, RejectedFull if the stash is full
+     */
+    InsertStatus mergeFingerprint(uint32_t fp, size_t index, bool skip_present);
 
 public:
 
@@ -93,9 +370,13 @@ public:
      * in set". Constructing Cuckoo Filter with specific table size, number of bits per fingerprint and number
      * of entries per bucket.
      *
-     * @param max_table_size Maximum table size
+     * @param max_table_size Maximum table size, number of buckets is chosen by index_policy::tableSize
+     * @param stash_size Number of fingerprints that can be stashed after failed insertions,
+     *                   between 1 and STASH_MAX_SIZE
+     * @param seed Hash seed, random by default. A filter rebuilt with the same seed and parameters
+     *             stores every element in the same buckets with the same fingerprint.
      */
-    CuckooFilter(uint32_t max_table_size);
+    CuckooFilter(uint32_t max_table_size, size_t stash_size = STASH_DEFAULT_SIZE, uint64_t seed = randomSeed());
 
     /**
      * Destructor that is in charge of memory clean-up.
@@ -111,19 +392,73 @@ public:
      * Inserting element into Cuckoo Filter. In first pass, fingerprint and index are calculated,
      * proceeding with insertion with reallocation.
      *
+     * @tparam key_type Key type, may differ from element_type if hasher_type hashes both equally,
+     *                  e.g. std::string_view for std::string elements
+     * @param element Element for insertion
+     * @return True if element is inserted or stashed, false if it is rejected
+     */
+    template<typename key_type = element_type>
+    bool insertElement(const key_type &element);
+
+    /**
+     * Inserting element into Cuckoo Filter and reporting where it ended up.
+     *
      * @param element Element for insertion
-     * @return True if element is inserted
+     * @param skip_present If true, element whose fingerprint is already contained is not inserted again
+     * @return Outcome of the insertion
+     */
+    template<typename key_type = element_type>
+    InsertStatus tryInsertElement(const key_type &element, bool skip_present = false);
+
+    /**
+     * Fused test-and-insert, inserting element only if its fingerprint is not contained yet. Hashes once
+     * and loads both candidate buckets once for the test and the insertion, cheaper than containsElement
+     * followed by insertElement.
+     *
+     * @param element Element for insertion
+     * @return AlreadyPresent if element was contained, otherwise outcome of the insertion
+     */
+    template<typename key_type = element_type>
+    InsertStatus insertIfAbsent(const key_type &element);
+
+    /**
+     * Setting hook which is consulted before kicking starts for a new element. Empty hook admits
+     * every element.
+     *
+     * @param hook Admission hook
+     */
+    void setAdmissionHook(AdmissionHook hook);
+
+    /**
+     * Setting how lookups reach the secondary bucket, Sequential by default.
+     *
+     * @param mode Lookup mode
+     */
+    void setLookupMode(LookupMode mode);
+
+    /**
+     * Retrieves lookup mode.
+     * @return lookup mode
+     */
+    LookupMode getLookupMode() const;
+
+    /**
+     * Retrieves current occupancy of the table and the stash.
+     * @return load snapshot
      */
-    bool insertElement(element_type &element);
+    FilterLoad getLoad();
 
     /**
      *  Deleting element from Cuckoo Filter. Algorithm requires checking both primary and secondary index,
-     *  if any of them contain fingerprint, it is removed from structure.
+     *  if any of them contain fingerprint, it is removed from structure. This is a fused test-and-delete,
+     *  both buckets are loaded together and the result tells whether the element was present, so no
+     *  containsElement is needed before it.
      *
      * @param element Element for deletion
      * @return True if item is deleted
      */
-    bool deleteElement(const element_type &element);
+    template<typename key_type = element_type>
+    bool deleteElement(const key_type &element);
 
     /**
      *  Checking if element is contained in Cuckoo Filter. Algorithm requires checking both primary and secondary index,
@@ -132,45 +467,273 @@ public:
      * @param element Element for deletion
      * @return True if item is contained
      */
-    bool containsElement(element_type &element);
+    template<typename key_type = element_type>
+    bool containsElement(const key_type &element) const;
 
     /**
-     * Calculates the percentage of free space in the table that the filter uses.
-     * @tparam element_type
-     * @tparam fp_type
+     * Inserting element given by its precomputed 64-bit hash value. The upper 32 bits select the primary
+     * bucket and the lower bits the fingerprint, so hash values must be well mixed and computed the same
+     * way for every operation on the filter. The filter seed is not applied.
+     *
+     * @param hash_value Hash value of the element
+     * @return True if element is inserted or stashed, false if it is rejected
+     */
+    bool insertHash(uint64_t hash_value);
+
+    /**
+     * Inserting element given by its precomputed hash value and reporting where it ended up.
+     *
+     * @param hash_value Hash value of the element
+     * @param skip_present If true, element whose fingerprint is already contained is not inserted again,
+     *                     the test is fused with the insertion as in insertIfAbsent
+     * @return Outcome of the insertion
+     */
+    InsertStatus tryInsertHash(uint64_t hash_value, bool skip_present = false);
+
+    /**
+     * Deleting element given by its precomputed hash value.
+     *
+     * @param hash_value Hash value of the element
+     * @return True if item is deleted
+     */
+    bool deleteHash(uint64_t hash_value);
+
+    /**
+     * Checking if element given by its precomputed hash value is contained.
+     *
+     * @param hash_value Hash value of the element
+     * @return True if item is contained
+     */
+    bool containsHash(uint64_t hash_value) const;
+
+    /**
+     * Inserting n elements given by precomputed hash values. Buckets of BATCH_SIZE consecutive elements
+     * are prefetched before they are inserted.
+     *
+     * @param hash_values Hash values of the elements
+     * @param n Number of elements
+     * @return Number of inserted or stashed elements
+     */
+    size_t insertHashes(const uint64_t *hash_values, size_t n);
+
+    /**
+     * Deleting n elements given by precomputed hash values.
+     *
+     * @param hash_values Hash values of the elements
+     * @param n Number of elements
+     * @return Number of deleted elements
+     */
+    size_t deleteHashes(const uint64_t *hash_values, size_t n);
+
+    /**
+     * Checking n elements given by precomputed hash values. Both candidate buckets of BATCH_SIZE
+     * consecutive elements are prefetched before any of them is probed.
+     *
+     * @param hash_values Hash values of the elements
+     * @param n Number of elements
+     * @param results Array of size n, results[k] is set to true if k-th element is contained
+     * @return Number of contained elements
+     */
+    size_t containsHashes(const uint64_t *hash_values, size_t n, bool *results) const;
+
+    /**
+     * First phase of a lookup split in two, calculates both candidate buckets and prefetches them.
+     * Running other work before endLookup hides the memory latency, see InterleavedLookup.
+     *
+     * @param element Element to look up
+     * @return Probe to be finished by endLookup
+     */
+    template<typename key_type = element_type>
+    LookupProbe beginLookup(const key_type &element) const;
+
+    /**
+     * First phase of a lookup of element given by its precomputed hash value.
+     *
+     * @param hash_value Hash value of the element
+     * @return Probe to be finished by endLookup
+     */
+    LookupProbe beginLookupHash(uint64_t hash_value) const;
+
+    /**
+     * Second phase of a lookup, probes buckets prefetched by beginLookup.
+     *
+     * @param probe Probe returned by beginLookup or beginLookupHash
+     * @return True if item is contained
+     */
+    bool endLookup(const LookupProbe &probe) const;
+
+    /**
+     * Freezing the filter into an immutable StaticFilter holding the same elements, for sets which are
+     * only queried from now on. The cuckoo filter keeps no keys, so every stored fingerprint is stored
+     * with its pair of candidate buckets; lookups of the static filter hash elements with the same seed
+     * and index policy. The filter itself is not modified.
+     *
+     * @tparam static_fp_type Fingerprint type of the static filter, uint8_t gives about 9 bits per element
+     * @return Static filter answering true for every element contained in this filter
+     */
+    template<typename static_fp_type = uint8_t>
+    StaticFilter<element_type, static_fp_type, hasher_type, CuckooKeyMapping<index_policy>> freeze();
+
+    /**
+     * Estimating occupancy after merging other into this filter, without modifying either. Every fingerprint
+     * of other is counted, stashed ones included, so with skip_present the estimate is an upper bound. Above
+     * a load factor of about 0.95 the merge is likely to overflow the stash.
+     *
+     * @param other Filter with the same template parameters, seed and table size
+     * @return Load of the merged filter
+     */
+    FilterLoad estimateMerge(const CuckooFilter &other) const;
+
+    /**
+     * Merging other into this filter, afterwards every element of either filter is contained. Fingerprints
+     * of other are reinserted from the buckets they are stored in, so no keys are needed, but both filters
+     * must have the same template parameters, seed and table size. The admission hook is not consulted.
+     *
+     * @param other Filter to merge, it is not modified
+     * @param skip_present If true, fingerprint which is already contained in one of its candidate buckets is
+     *                     not stored again; saves space for overlapping sets, but deleting such an element
+     *                     removes it for both sources
+     * @return True if every fingerprint of other is merged, false if the stash overflowed and the remaining
+     *         fingerprints were dropped
+     * @throws std::runtime_error if other is this filter or has a different seed or table size
+     */
+    bool merge(const CuckooFilter &other, bool skip_present = false);
+
+    /**
+     * Merging other into this filter like merge, with the table split into bucket ranges merged by threads
+     * in parallel. A thread only stores fingerprints into free entries of the bucket they occupy in other,
+     * which lies in its own range and whose load does not reach the next range; the remaining ones are merged
+     * with kicking after the threads join. With skip_present, presence is checked against this filter as it
+     * was before the merge, duplicates within other are kept.
+     *
+     * @param other Filter to merge, it is not modified
+     * @param threads Number of threads, at least 1
+     * @param skip_present If true, fingerprint which is already contained in one of its candidate buckets is
+     *                     not stored again
+     * @return True if every fingerprint of other is merged, false if the stash overflowed and the remaining
+     *         fingerprints were dropped
+     * @throws std::runtime_error if other is this filter or has a different seed or table size
+     */
+    bool mergeParallel(const CuckooFilter &other, size_t threads, bool skip_present = false);
+
+    /**
+     * Starting to track written bucket ranges for extractDelta. Tracking is off by default, since it costs
+     * every table store a bitmap test. Enabled right after construction, the first delta covers every change,
+     * so it brings an empty replica up to date; enabled later, replicas have to start from a snapshot.
+     */
+    void enableDirtyTracking();
+
+    /**
+     * Extracting changes since the previous delta for replicas, see filter_delta.hpp. Bucket ranges written
+     * since the previous extraction are copied and their dirty bits cleared, element count and stash are
+     * copied whole. A snapshot enables dirty tracking, so deltas can follow it.
+     *
+     * @param snapshot If true, every range is included, for replicas which start late or missed deltas
+     * @return Delta with the next sequence number
+     * @throws std::runtime_error if a delta which is not a snapshot is requested without dirty tracking
+     */
+    FilterDelta extractDelta(bool snapshot = false);
+
+    /**
+     * Applying delta extracted from a primary filter with the same template parameters, seed and table size.
+     *
+     * @param delta Delta from extractDelta
+     * @return True if the delta is applied, false if it does not directly follow the last applied one and
+     *         is not a snapshot; nothing is changed then
+     * @throws std::runtime_error if the delta comes from a filter of different geometry or seed, or does
+     *         not fit into it
+     */
+    bool applyDelta(const FilterDelta &delta);
+
+    /**
+     * Retrieves sequence number of the last extracted or applied delta.
+     * @return sequence number, 0 before the first delta
+     */
+    uint64_t getSequence() const;
+
+    /**
+     * Calculates the percentage of free space in the table that the filter uses. Constant time, derived
+     * from the maintained element count.
      * @return percentage of free space in the cuckoo filter's table
      */
     double availability();
 
+    /**
+     * Retrieves number of fingerprints stored in the table, stashed fingerprints are not included.
+     * @return element count
+     */
+    size_t getElementCount();
+
+    /**
+     * Retrieves ratio of occupied entries in the table.
+     * @return load factor between 0 and 1
+     */
+    double getLoadFactor();
+
+    /**
+     * Counts occupied entries by scanning the whole table and compares the result with the maintained
+     * element count. Linear in table size, meant for tests and occasional consistency checks.
+     * @return True if the maintained element count is correct
+     */
+    bool auditElementCount();
+
     /**
      * Retrieves total number of buckets in the table.
      * @return table size
      */
     size_t getTableSize();
+
+    /**
+     * Retrieves hash seed of the filter, needed to rebuild a filter which stores elements equally.
+     * @return hash seed
+     */
+    uint64_t getSeed();
+
+    /**
+     * Retrieves number of fingerprints currently kept in the stash.
+     * @return stash size
+     */
+    size_t getStashSize();
 };
 
 
 
-template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
-CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type>::CuckooFilter(uint32_t max_table_size) {
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+CuckooFilter(uint32_t max_table_size, size_t stash_size, uint64_t seed)
+        : index_policy_(index_policy::tableSize(max_table_size, entries_per_bucket), entries_per_bucket),
+          stash_(stash_size) {
+    if (stash_size == 0 || stash_size > STASH_MAX_SIZE) {
+        throw std::runtime_error("Invalid stash size, supported values are 1 to " +
+                                 std::to_string(STASH_MAX_SIZE) + ".\n");
+    }
+    if (max_table_size == 0) {
+        throw std::runtime_error("Table size must be positive.\n");
+    }
     element_count_ = 0;
+    lookup_mode_ = LookupMode::Sequential;
+    sequence_ = 0;
     this->fp_mask_ = (1ULL << bits_per_fp) - 1;
-    size_t table_size = highestPowerOfTwo(max_table_size);
+    size_t table_size = index_policy::tableSize(max_table_size, entries_per_bucket);
 
     table_ = new CuckooTable<entries_per_bucket, bits_per_fp, fp_type>(table_size, fp_mask_);
-    hash_function_ = new HashFunction();
+    hash_function_ = new HashFunction<hasher_type>(seed);
 }
 
 
-template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
-size_t CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type>::getIndex(uint32_t hash_value) const {
-    // equivalent to modulo when number of buckets is a power of two
-    return hash_value & (table_->getTableSize() - 1);
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+size_t CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+getIndex(uint32_t hash_value) const {
+    return index_policy_.index(hash_value);
 }
 
 
-template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
-uint32_t CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type>::fingerprint(uint32_t hash_value) const {
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+uint32_t CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+fingerprint(uint32_t hash_value) const {
     uint32_t fingerprint = hash_value & fp_mask_;
     // make sure that fingerprint != 0
     fingerprint += (fingerprint == 0);
@@ -178,138 +741,677 @@ uint32_t CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type>::f
 }
 
 
-template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
-inline void CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type>::
-firstPass(const element_type &item, uint32_t *fp, size_t *index) const {
-    const uint64_t hash_value = hash_function_->hash(item, table_->getTableSize());
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+inline void CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+firstPass(const uint64_t hash_value, uint32_t *fp, size_t *index) const {
     *index = getIndex(hash_value >> 32);
     *fp = fingerprint(hash_value);
 }
 
 
-template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
-uint32_t CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type>::
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+uint32_t CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
 indexComplement(const size_t index, const uint32_t fp) const {
-    uint32_t hv = fingerprintComplement(index, fp);
-    return getIndex(hv);
+    return index_policy_.alternate(index, fp);
 }
 
 
-template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
-bool CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type>::
-insert(uint32_t fp, size_t index) {
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+KickChain<CuckooTable<entries_per_bucket, bits_per_fp, fp_type>, index_policy, PlainEntry>
+CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::chain() {
+    return {*table_, index_policy_, stash_, element_count_};
+}
 
-    size_t curr_index = index;
-    uint32_t curr_fp = fp;
-    uint32_t prev_fp;
 
-    for (int kicks = 0; kicks < KICKS_MAX_COUNT; kicks++) {
-        bool eject = (kicks != 0);
-        prev_fp = 0;
-        if (table_->replacingFingerprintInsertion(curr_index, curr_fp, eject, prev_fp)) {
-            this->element_count_++;
-            return true;
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+InsertStatus CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+insert(uint32_t fp, size_t index, const bool admit) {
+    // the hook is consulted once both candidate buckets were found full
+    return chain().insert(fp, index, admit, [this, admit](int kicks, size_t) {
+        return kicks != 2 || !admit || !admission_hook_ || admission_hook_(getLoad());
+    });
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+template<typename key_type>
+bool CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+insertElement(const key_type &element) {
+    return tryInsertElement(element) != InsertStatus::RejectedFull;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+template<typename key_type>
+InsertStatus CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+tryInsertElement(const key_type &element, const bool skip_present) {
+    return tryInsertHash(hash_function_->hash(element), skip_present);
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+template<typename key_type>
+InsertStatus CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+insertIfAbsent(const key_type &element) {
+    return tryInsertHash(hash_function_->hash(element), true);
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+InsertStatus CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+tryInsertHash(const uint64_t hash_value, const bool skip_present) {
+    size_t index;
+    uint32_t fp;
+
+    CF_STATS(StatsRegistry::local().insertions++);
+
+    // a failed kick chain could not be stashed
+    if (stash_.full()) {
+        CF_STATS(StatsRegistry::local().rejected++);
+        return InsertStatus::RejectedFull;
+    }
+
+    firstPass(hash_value, &fp, &index);
+
+    if (skip_present) {
+        size_t i2 = indexComplement(index, fp);
+        if (!stash_.empty() && stash_.contains(fp, index, i2)) {
+            return InsertStatus::AlreadyPresent;
         }
-        if (eject) {
-            curr_fp = prev_fp;
+        bool present;
+        if (table_->insertIfAbsent(index, i2, fp, present)) {
+            if (present) {
+                return InsertStatus::AlreadyPresent;
+            }
+            this->element_count_++;
+            CF_STATS(StatsRegistry::local().recordKicks(0));
+            return InsertStatus::Inserted;
         }
-        curr_index = indexComplement(curr_index, curr_fp);
+        // both buckets are full, continuing with kicking
     }
 
-    victim_.index = curr_index;
-    victim_.fp = curr_fp;
-    return true;
+    return this->insert(fp, index, true);
 }
 
 
-template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
-bool CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type>::
-insertElement(element_type &element) {
-    size_t index;
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+void CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+setAdmissionHook(AdmissionHook hook) {
+    this->admission_hook_ = hook;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+void CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+setLookupMode(const LookupMode mode) {
+    this->lookup_mode_ = mode;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+LookupMode CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+getLookupMode() const {
+    return this->lookup_mode_;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+FilterLoad CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::getLoad() {
+    FilterLoad load;
+    load.element_count = this->element_count_;
+    load.capacity = this->table_->maxNoOfElements();
+    load.stash_size = this->stash_.size();
+    load.stash_capacity = this->stash_.capacity();
+    load.load_factor = getLoadFactor();
+    return load;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+template<typename key_type>
+bool CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+deleteElement(const key_type &element) {
+    return deleteHash(hash_function_->hash(element));
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+bool CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+deleteHash(const uint64_t hash_value) {
     uint32_t fp;
+    size_t i1;
 
-    if (victim_.fp) return false;
+    CF_STATS(StatsRegistry::local().deletions++);
 
-    firstPass(element, &fp, &index);
-    return this->insert(fp, index);
+    firstPass(hash_value, &fp, &i1);
+    return chain().remove(fp, i1, indexComplement(i1, fp));
 }
 
 
-template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
-bool CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type>::
-deleteElement(const element_type &element) {
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+template<typename key_type>
+bool CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+containsElement(const key_type &element) const {
+    return containsHash(hash_function_->hash(element));
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+bool CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+containsHash(const uint64_t hash_value) const {
     uint32_t fp;
-    size_t i1, i2;
+    size_t i1, i2 = 0;
 
-    firstPass(element, &fp, &i1);
+    CF_STATS(StatsRegistry::local().lookups++);
 
-    if (table_->deleteFingerprint(fp, i1)) {
-        this->element_count_--;
-    } else {
+    firstPass(hash_value, &fp, &i1);
+    if (lookup_mode_ == LookupMode::Speculative) {
         i2 = indexComplement(i1, fp);
-        if (table_->deleteFingerprint(fp, i2)) {
-            this->element_count_--;
-        } else if (victim_.fp && fp == victim_.fp &&
-                   (i1 == victim_.index || i2 == victim_.index)) {
-            // element count remains unmodified, victim is not regarded as a part of the table
-            victim_.fp = 0;
-            return true;
-        } else {
+        table_->prefetchBucket(i2, false);
+    }
+    if (table_->containsFingerprint(i1, fp)) {
+        CF_STATS(StatsRegistry::local().lookup_hits++; StatsRegistry::local().first_bucket_hits++);
+        return true;
+    }
+
+    if (lookup_mode_ == LookupMode::Sequential) {
+        i2 = indexComplement(i1, fp);
+    }
+
+    if (table_->containsFingerprint(i2, fp)) {
+        CF_STATS(StatsRegistry::local().lookup_hits++);
+        return true;
+    }
+    if (!stash_.empty() && stash_.contains(fp, i1, i2)) {
+        CF_STATS(StatsRegistry::local().lookup_hits++; StatsRegistry::local().stash_hits++);
+        return true;
+    }
+    return false;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+bool CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+insertHash(const uint64_t hash_value) {
+    return tryInsertHash(hash_value) != InsertStatus::RejectedFull;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+size_t CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+insertHashes(const uint64_t *hash_values, const size_t n) {
+    size_t inserted = 0;
+    uint32_t fp;
+    size_t index;
+
+    for (size_t start = 0; start < n; start += BATCH_SIZE) {
+        size_t end = std::min(n, start + BATCH_SIZE);
+        for (size_t k = start; k < end; k++) {
+            firstPass(hash_values[k], &fp, &index);
+            table_->prefetchBucket(index, true);
+        }
+        for (size_t k = start; k < end; k++) {
+            inserted += insertHash(hash_values[k]);
+        }
+    }
+    return inserted;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+size_t CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+deleteHashes(const uint64_t *hash_values, const size_t n) {
+    size_t deleted = 0;
+    uint32_t fp;
+    size_t index;
+
+    for (size_t start = 0; start < n; start += BATCH_SIZE) {
+        size_t end = std::min(n, start + BATCH_SIZE);
+        for (size_t k = start; k < end; k++) {
+            firstPass(hash_values[k], &fp, &index);
+            table_->prefetchBucket(index, true);
+        }
+        for (size_t k = start; k < end; k++) {
+            deleted += deleteHash(hash_values[k]);
+        }
+    }
+    return deleted;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+size_t CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+containsHashes(const uint64_t *hash_values, const size_t n, bool *results) const {
+    size_t contained = 0;
+    LookupProbe probes[BATCH_SIZE];
+
+    for (size_t start = 0; start < n; start += BATCH_SIZE) {
+        size_t count = std::min(n - start, (size_t) BATCH_SIZE);
+        for (size_t k = 0; k < count; k++) {
+            probes[k] = beginLookupHash(hash_values[start + k]);
+        }
+        for (size_t k = 0; k < count; k++) {
+            bool found = endLookup(probes[k]);
+            results[start + k] = found;
+            contained += found;
+        }
+    }
+    return contained;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+template<typename key_type>
+LookupProbe CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+beginLookup(const key_type &element) const {
+    return beginLookupHash(hash_function_->hash(element));
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+LookupProbe CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+beginLookupHash(const uint64_t hash_value) const {
+    LookupProbe probe;
+    firstPass(hash_value, &probe.fp, &probe.i1);
+    probe.i2 = indexComplement(probe.i1, probe.fp);
+    table_->prefetchBucket(probe.i1, false);
+    table_->prefetchBucket(probe.i2, false);
+    return probe;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+bool CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+endLookup(const LookupProbe &probe) const {
+    bool found = table_->containsFingerprint(probe.i1, probe.i2, probe.fp) ||
+                 (!stash_.empty() && stash_.contains(probe.fp, probe.i1, probe.i2));
+    CF_STATS(StatsRegistry::local().lookups++; StatsRegistry::local().lookup_hits += found);
+    return found;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+template<typename static_fp_type>
+StaticFilter<element_type, static_fp_type, hasher_type, CuckooKeyMapping<index_policy>>
+CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::freeze() {
+    CuckooKeyMapping<index_policy> mapping(index_policy_, fp_mask_);
+    std::vector<uint64_t> stored;
+    stored.reserve(element_count_ + stash_.size());
+
+    for (size_t i = 0; i < table_->getTableSize(); i++) {
+        for (size_t j = 0; j < entries_per_bucket; j++) {
+            uint32_t fp = table_->getFingerprint(i, j);
+            if (fp != 0) {
+                stored.push_back(mapping.entry(i, fp));
+            }
+        }
+    }
+    for (size_t k = 0; k < stash_.size(); k++) {
+        Victim victim = stash_.get(k);
+        stored.push_back(mapping.entry(victim.index, victim.fp));
+    }
+
+    return StaticFilter<element_type, static_fp_type, hasher_type, CuckooKeyMapping<index_policy>>(
+            stored.data(), stored.size(), getSeed(), mapping);
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+void CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+checkMergeable(const CuckooFilter &other) const {
+    if (&other == this) {
+        throw std::runtime_error("Filter cannot be merged into itself.\n");
+    }
+    if (other.table_->getTableSize() != table_->getTableSize()) {
+        throw std::runtime_error("Filters with different table sizes cannot be merged.\n");
+    }
+    if (other.hash_function_->getSeed() != hash_function_->getSeed()) {
+        throw std::runtime_error("Filters with different seeds cannot be merged.\n");
+    }
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+InsertStatus CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+mergeFingerprint(const uint32_t fp, const size_t index, const bool skip_present) {
+    if (stash_.full()) {
+        return InsertStatus::RejectedFull;
+    }
+    if (skip_present) {
+        size_t i2 = indexComplement(index, fp);
+        if (!stash_.empty() && stash_.contains(fp, index, i2)) {
+            return InsertStatus::AlreadyPresent;
+        }
+        bool present;
+        if (table_->insertIfAbsent(index, i2, fp, present)) {
+            if (present) {
+                return InsertStatus::AlreadyPresent;
+            }
+            this->element_count_++;
+            return InsertStatus::Inserted;
+        }
+    }
+    return this->insert(fp, index, false);
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+FilterLoad CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+estimateMerge(const CuckooFilter &other) const {
+    checkMergeable(other);
+    FilterLoad load;
+    load.element_count = this->element_count_ + other.element_count_ + other.stash_.size();
+    load.capacity = this->table_->maxNoOfElements();
+    load.stash_size = this->stash_.size();
+    load.stash_capacity = this->stash_.capacity();
+    load.load_factor = load.element_count / (double) load.capacity;
+    return load;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+bool CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+merge(const CuckooFilter &other, const bool skip_present) {
+    checkMergeable(other);
+
+    bool complete = true;
+    for (size_t i = 0; i < table_->getTableSize() && complete; i++) {
+        other.table_->forEachEntry(i, [&](uint32_t fp) {
+            complete = complete && mergeFingerprint(fp, i, skip_present) != InsertStatus::RejectedFull;
+        });
+    }
+    if (!complete) {
+        return false;
+    }
+    for (size_t k = 0; k < other.stash_.size(); k++) {
+        Victim victim = other.stash_.get(k);
+        if (mergeFingerprint(victim.fp, victim.index, skip_present) == InsertStatus::RejectedFull) {
             return false;
         }
     }
+    return true;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+bool CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+mergeParallel(const CuckooFilter &other, size_t threads, const bool skip_present) {
+    checkMergeable(other);
+
+    const size_t table_size = table_->getTableSize();
+    threads = std::max((size_t) 1, std::min(threads, table_size));
+    const size_t range = (table_size + threads - 1) / threads;
+    // fingerprints which did not fit into their bucket, and number of stored ones, per thread
+    std::vector<std::vector<Victim>> pending(threads);
+    std::vector<size_t> stored(threads, 0);
 
-    if (victim_.fp) {
-        size_t index = victim_.index;
-        uint32_t fp = victim_.fp;
-        victim_.fp = 0;
-        this->insert(fp, index);
+    auto runRanges = [&](const std::function<void(size_t, size_t, size_t)> &fn) {
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; t++) {
+            workers.emplace_back(fn, t, std::min(table_size, t * range), std::min(table_size, (t + 1) * range));
+        }
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+    };
+    // bucket stores write only the bytes of their own bucket, but a bucket load reaches into the following
+    // buckets, so the last ones of a range are left to the serial pass
+    const size_t reach = CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::getPaddingBuckets();
+    auto place = [&](size_t t, size_t to) {
+        uint32_t prev_fp;
+        size_t kept = 0;
+        for (const Victim &victim : pending[t]) {
+            if (victim.index + reach <= to &&
+                table_->replacingFingerprintInsertion(victim.index, victim.fp, false, prev_fp)) {
+                stored[t]++;
+            } else {
+                pending[t][kept++] = victim;
+            }
+        }
+        pending[t].resize(kept);
+    };
+
+    runRanges([&](size_t t, size_t from, size_t to) {
+        for (size_t i = from; i < to; i++) {
+            other.table_->forEachEntry(i, [&](uint32_t fp) {
+                if (skip_present) {
+                    size_t i2 = indexComplement(i, fp);
+                    if (table_->containsFingerprint(i, i2, fp) || (!stash_.empty() && stash_.contains(fp, i, i2))) {
+                        return;
+                    }
+                }
+                Victim victim;
+                victim.fp = fp;
+                victim.index = i;
+                pending[t].push_back(victim);
+            });
+        }
+        // presence checks read buckets of other ranges, so nothing is stored until every thread checked
+        if (!skip_present) {
+            place(t, to);
+        }
+    });
+    if (skip_present) {
+        runRanges([&](size_t t, size_t, size_t to) { place(t, to); });
     }
 
+    for (size_t t = 0; t < threads; t++) {
+        this->element_count_ += stored[t];
+    }
+    for (size_t t = 0; t < threads; t++) {
+        for (const Victim &victim : pending[t]) {
+            if (mergeFingerprint(victim.fp, victim.index, false) == InsertStatus::RejectedFull) {
+                return false;
+            }
+        }
+    }
+    for (size_t k = 0; k < other.stash_.size(); k++) {
+        Victim victim = other.stash_.get(k);
+        if (mergeFingerprint(victim.fp, victim.index, skip_present) == InsertStatus::RejectedFull) {
+            return false;
+        }
+    }
     return true;
 }
 
 
-template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
-bool CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type>::
-containsElement(element_type &element) {
-    uint32_t fp;
-    size_t i1, i2;
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+void CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+enableDirtyTracking() {
+    table_->enableDirtyTracking();
+}
 
-    firstPass(element, &fp, &i1);
-    if (table_->containsFingerprint(i1, fp)) {
-        return true;
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+FilterDelta CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+extractDelta(const bool snapshot) {
+    if (!snapshot && !table_->isDirtyTracking()) {
+        throw std::runtime_error("Deltas need dirty tracking, call enableDirtyTracking or extract a snapshot.\n");
+    }
+    table_->enableDirtyTracking();
+
+    FilterDelta delta;
+    delta.sequence = ++this->sequence_;
+    delta.snapshot = snapshot;
+    delta.seed = getSeed();
+    delta.table_size = table_->getTableSize();
+    delta.entries_per_bucket = entries_per_bucket;
+    delta.bits_per_fp = bits_per_fp;
+    delta.element_count = element_count_;
+    for (size_t k = 0; k < stash_.size(); k++) {
+        delta.stash.push_back(stash_.get(k));
+    }
+
+    // dirty bits are cleared by a snapshot too, the next delta follows it
+    std::vector<size_t> dirty = table_->takeDirtyRanges();
+    if (snapshot) {
+        for (size_t range = 0; range < table_->getRangeCount(); range++) {
+            delta.ranges.push_back(range);
+        }
+    } else {
+        delta.ranges.assign(dirty.begin(), dirty.end());
+    }
+    for (uint64_t range : delta.ranges) {
+        size_t offset = delta.data.size();
+        delta.data.resize(offset + table_->getRangeBytes(range));
+        table_->readRange(range, delta.data.data() + offset);
+    }
+    return delta;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+bool CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+applyDelta(const FilterDelta &delta) {
+    if (delta.seed != getSeed() || delta.table_size != table_->getTableSize() ||
+        delta.entries_per_bucket != entries_per_bucket || delta.bits_per_fp != bits_per_fp) {
+        throw std::runtime_error("Delta comes from a filter with different geometry or seed.\n");
+    }
+    if (!delta.snapshot && delta.sequence != this->sequence_ + 1) {
+        return false;
+    }
+    if (delta.stash.size() > stash_.capacity()) {
+        throw std::runtime_error("Stashed fingerprints of the delta do not fit into the stash.\n");
+    }
+    for (const Victim &victim : delta.stash) {
+        if (victim.index >= table_->getTableSize() || victim.fp == 0 || (victim.fp & ~fp_mask_) != 0) {
+            throw std::runtime_error("Delta stash entry for bucket " + std::to_string(victim.index) +
+                                     " is not valid for the table.\n");
+        }
+    }
+    size_t bytes = 0;
+    for (uint64_t range : delta.ranges) {
+        if (range >= table_->getRangeCount()) {
+            throw std::runtime_error("Delta range " + std::to_string(range) + " is out of the table.\n");
+        }
+        bytes += table_->getRangeBytes(range);
+    }
+    if (bytes != delta.data.size()) {
+        throw std::runtime_error("Delta data does not match its ranges.\n");
     }
 
-    i2 = indexComplement(i1, fp);
+    size_t offset = 0;
+    for (uint64_t range : delta.ranges) {
+        table_->writeRange(range, delta.data.data() + offset);
+        offset += table_->getRangeBytes(range);
+    }
+    this->element_count_ = delta.element_count;
+    this->stash_ = VictimStash(stash_.capacity());
+    for (const Victim &victim : delta.stash) {
+        stash_.push(victim.fp, victim.index);
+    }
+    this->sequence_ = delta.sequence;
+    return true;
+}
+
 
-    return table_->containsFingerprint(i2, fp) ||
-           (victim_.fp && (fp == victim_.fp) && (i1 == victim_.index || i2 == victim_.index));
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+uint64_t CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+getSequence() const {
+    return this->sequence_;
 }
 
 
-template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
-void CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type>::print() {
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+void CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::print() {
     table_->printTable();
 }
 
 
-template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
-CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type>::~CuckooFilter() {
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::~CuckooFilter() {
     delete table_;
     delete hash_function_;
 }
 
 
-template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
-double CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type>::availability() {
-    size_t free = this->table_->getNumOfFreeEntries();
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+double CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::availability() {
     size_t ts = this->table_->maxNoOfElements();
+    size_t free = ts - this->element_count_;
     return (free / ((double) ts)) * 100.;
 }
 
 
-template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
-size_t CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type>::getTableSize() {
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+size_t CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+getElementCount() {
+    return this->element_count_;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+double CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+getLoadFactor() {
+    return this->element_count_ / ((double) this->table_->maxNoOfElements());
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+bool CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::
+auditElementCount() {
+    size_t occupied = this->table_->maxNoOfElements() - this->table_->getNumOfFreeEntries();
+    return occupied == this->element_count_;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+size_t CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::getTableSize() {
     return this->table_->getTableSize();
 }
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+size_t CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::getStashSize() {
+    return this->stash_.size();
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type,
+         typename hasher_type, typename index_policy>
+uint64_t CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type, hasher_type, index_policy>::getSeed() {
+    return this->hash_function_->getSeed();
+}
+
+#endif
@@ -0,0 +1,623 @@
+#ifndef CUCKOOFILTER_CUCKOO_MAP_H
+#define CUCKOOFILTER_CUCKOO_MAP_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include "bit_manager.hpp"
+#include "cuckoo_filter.hpp"
+
+// target size of a bucket, one cache line
+#define MAP_BUCKET_BYTES 64
+// tags of a bucket are probed as one 32-bit word of 8-bit lanes by BitManager8
+#define MAP_TAG_LANES 4
+// number of version counters guarding buckets, bucket i is guarded by counter i % MAP_VERSION_STRIPES
+#define MAP_VERSION_STRIPES 4096
+
+
+/**
+ * Cuckoo hash map storing full keys and values next to 8-bit tags, built from the same parts as
+ * CuckooFilter: two candidate buckets chosen by index_policy, tags probed with BitManager8 like 8-bit
+ * fingerprints, random-walk kicking limited by KICKS_MAX_COUNT and a small stash for entries whose walk
+ * failed. As many entries as fit into MAP_BUCKET_BYTES, at most MAP_TAG_LANES, share a bucket.
+ *
+ * Lookups run concurrently with each other and with one writer at a time. Writers are serialized by a
+ * mutex; lookups take no lock but read buckets optimistically, guarded by striped version counters which
+ * writers make odd while they modify a bucket (a seqlock, as in MemC3). A lookup retries if a version
+ * changed while it read, so it never returns a torn entry. Kicking first searches a path to a free slot
+ * and then moves entries backwards along it, every entry is copied to its other bucket before it is
+ * removed from the old one, so moved entries stay visible. Keys and values must be trivially copyable.
+ *
+ * @tparam key_type Key type, compared with ==
+ * @tparam value_type Value type
+ * @tparam hasher_type Functor mapping keys to 64-bit hash values, see KeyHash
+ * @tparam index_policy Mapping of hash values and tags to buckets
+ */
+template<typename key_type, typename value_type, typename hasher_type = TransparentKeyHash,
+         typename index_policy = XorIndexPolicy>
+class CuckooMap {
+
+    static_assert(std::is_trivially_copyable<key_type>::value && std::is_trivially_copyable<value_type>::value,
+                  "CuckooMap keys and values are read optimistically and must be trivially copyable");
+
+public:
+    // number of entries per bucket, as many as fit into MAP_BUCKET_BYTES next to the tags
+    static const size_t entries_per_bucket =
+            std::min((size_t) MAP_TAG_LANES, std::max((size_t) 1, (MAP_BUCKET_BYTES - MAP_TAG_LANES) /
+                                                                   (sizeof(key_type) + sizeof(value_type))));
+
+private:
+    struct alignas(MAP_BUCKET_BYTES) Bucket {
+        // 0 marks a free entry
+        uint8_t tags[MAP_TAG_LANES];
+        key_type keys[entries_per_bucket];
+        value_type values[entries_per_bucket];
+    };
+
+    // entry whose kick path could not be found
+    struct StashEntry {
+        key_type key;
+        value_type value;
+        uint32_t tag;
+        size_t index;
+    };
+
+    // one step of a kick path, the entry in slot of bucket moves to the next step's bucket
+    struct PathStep {
+        size_t bucket;
+        size_t slot;
+    };
+
+    // number of buckets
+    size_t table_size_;
+
+    Bucket *buckets_;
+
+    // maps hash values and tags to buckets
+    index_policy index_policy_;
+
+    // used for calculating hash values
+    HashFunction<hasher_type> hash_function_;
+
+    // probes tag words
+    mutable BitManager8<uint8_t> tag_manager_;
+
+    // odd while a guarded bucket is being modified
+    std::atomic<uint32_t> *versions_;
+
+    StashEntry stash_[STASH_MAX_SIZE];
+    std::atomic<size_t> stash_size_;
+    size_t stash_capacity_;
+    std::atomic<uint32_t> stash_version_;
+
+    std::atomic<size_t> element_count_;
+
+    // serializes writers
+    std::mutex write_mutex_;
+
+    /**
+     * Calculating primary bucket and tag from element hash value.
+     */
+    inline void firstPass(uint64_t hash_value, uint32_t *tag, size_t *index) const;
+
+    /**
+     * Counter guarding bucket i.
+     */
+    inline std::atomic<uint32_t> &version(size_t i) const;
+
+    /**
+     * Making counter of bucket i odd before it is modified.
+     */
+    inline void beginWrite(size_t i);
+
+    /**
+     * Making counter of bucket i even again after it is modified.
+     */
+    inline void endWrite(size_t i);
+
+    /**
+     * Match mask of tag in bucket i, restricted to used lanes. Free entries are found with tag 0.
+     */
+    inline uint64_t matchTags(size_t i, uint32_t tag) const;
+
+    /**
+     * Index of the first lane marked in a match mask.
+     */
+    inline static size_t lane(uint64_t mask);
+
+    /**
+     * Slot of key in bucket i, or entries_per_bucket if bucket does not contain it.
+     */
+    inline size_t findSlot(size_t i, const key_type &key, uint32_t tag) const;
+
+    /**
+     * Position of key in the stash, or its size if the stash does not contain it.
+     */
+    size_t findStashed(const key_type &key, uint32_t tag, size_t i1, size_t i2) const;
+
+    /**
+     * Storing entry in slot of bucket i.
+     */
+    inline void store(size_t i, size_t slot, const key_type &key, const value_type &value, uint32_t tag);
+
+    /**
+     * Placing a new entry with candidate buckets i1 and i2 into a free slot, kicking other entries along a
+     * path to a free slot if both buckets are full.
+     *
+     * @return False if no path was found, the table is not modified then
+     */
+    bool place(const key_type &key, const value_type &value, uint32_t tag, size_t i1, size_t i2);
+
+    /**
+     * Moving stashed entries back to the table after an entry was erased.
+     */
+    void drainStash();
+
+public:
+
+    /**
+     * @param max_table_size Maximum number of buckets, number of buckets is chosen by index_policy::tableSize
+     * @param stash_size Number of entries that can be stashed after failed insertions,
+     *                   between 1 and STASH_MAX_SIZE
+     * @param seed Hash seed, random by default
+     */
+    CuckooMap(uint32_t max_table_size, size_t stash_size = STASH_DEFAULT_SIZE, uint64_t seed = randomSeed());
+
+    /**
+     * Destructor that is in charge of memory clean-up.
+     */
+    ~CuckooMap();
+
+    /**
+     * Inserting key with value, or replacing the value if key is already contained. Blocks while another
+     * writer runs.
+     *
+     * @param key Key
+     * @param value Value
+     * @return Inserted or Stashed for a new key, AlreadyPresent if the value was replaced, RejectedFull
+     *         if the stash is full
+     */
+    InsertStatus insert(const key_type &key, const value_type &value);
+
+    /**
+     * Erasing key. Blocks while another writer runs.
+     *
+     * @param key Key
+     * @return True if key was contained
+     */
+    bool erase(const key_type &key);
+
+    /**
+     * Looking up value of key, safe to call concurrently with other lookups and with writers.
+     *
+     * @param key Key
+     * @param value Set to value of key if it is contained
+     * @return True if key is contained
+     */
+    bool find(const key_type &key, value_type &value) const;
+
+    /**
+     * Checking if key is contained, safe to call concurrently with other lookups and with writers.
+     *
+     * @param key Key
+     * @return True if key is contained
+     */
+    bool contains(const key_type &key) const;
+
+    /**
+     * Retrieves number of stored entries, stashed entries included.
+     * @return element count
+     */
+    size_t getElementCount() const;
+
+    /**
+     * Retrieves ratio of occupied entries in the table.
+     * @return load factor between 0 and 1
+     */
+    double getLoadFactor() const;
+
+    /**
+     * Retrieves total number of buckets in the table.
+     * @return table size
+     */
+    size_t getTableSize() const;
+
+    /**
+     * Retrieves size of the bucket array in bytes.
+     * @return table size in bytes
+     */
+    size_t getTableBytes() const;
+
+    /**
+     * Retrieves number of entries currently kept in the stash.
+     * @return stash size
+     */
+    size_t getStashSize() const;
+
+    /**
+     * Retrieves hash seed of the map.
+     * @return hash seed
+     */
+    uint64_t getSeed() const;
+};
+
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+CuckooMap<key_type, value_type, hasher_type, index_policy>::
+CuckooMap(uint32_t max_table_size, size_t stash_size, uint64_t seed)
+        : table_size_(index_policy::tableSize(max_table_size, entries_per_bucket)),
+          index_policy_(index_policy::tableSize(max_table_size, entries_per_bucket), entries_per_bucket),
+          hash_function_(seed), stash_size_(0), stash_capacity_(stash_size), stash_version_(0), element_count_(0) {
+    if (stash_size == 0 || stash_size > STASH_MAX_SIZE) {
+        throw std::runtime_error("Invalid stash size, supported values are 1 to " +
+                                 std::to_string(STASH_MAX_SIZE) + ".\n");
+    }
+    if (table_size_ == 0) {
+        throw std::runtime_error("Table size must be positive.\n");
+    }
+    buckets_ = new Bucket[table_size_];
+    memset((void *) buckets_, 0, sizeof(Bucket) * table_size_);
+    versions_ = new std::atomic<uint32_t>[MAP_VERSION_STRIPES];
+    for (size_t s = 0; s < MAP_VERSION_STRIPES; s++) {
+        versions_[s].store(0, std::memory_order_relaxed);
+    }
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+CuckooMap<key_type, value_type, hasher_type, index_policy>::~CuckooMap() {
+    delete[] buckets_;
+    delete[] versions_;
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+void CuckooMap<key_type, value_type, hasher_type, index_policy>::
+firstPass(const uint64_t hash_value, uint32_t *tag, size_t *index) const {
+    *index = index_policy_.index(hash_value >> 32);
+    *tag = hash_value & 0xFF;
+    // make sure that tag != 0
+    *tag += (*tag == 0);
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+std::atomic<uint32_t> &CuckooMap<key_type, value_type, hasher_type, index_policy>::version(const size_t i) const {
+    return versions_[i % MAP_VERSION_STRIPES];
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+void CuckooMap<key_type, value_type, hasher_type, index_policy>::beginWrite(const size_t i) {
+    version(i).fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+void CuckooMap<key_type, value_type, hasher_type, index_policy>::endWrite(const size_t i) {
+    version(i).fetch_add(1, std::memory_order_release);
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+uint64_t CuckooMap<key_type, value_type, hasher_type, index_policy>::
+matchTags(const size_t i, const uint32_t tag) const {
+    // lanes above entries_per_bucket are always 0, they must not be taken for free entries
+    const uint64_t used = (1ULL << (8 * entries_per_bucket)) - 1;
+    uint32_t word;
+    memcpy(&word, buckets_[i].tags, sizeof(word));
+    return tag_manager_.matchMask(word, tag) & used;
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+size_t CuckooMap<key_type, value_type, hasher_type, index_policy>::lane(const uint64_t mask) {
+    return __builtin_ctzll(mask) / 8;
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+size_t CuckooMap<key_type, value_type, hasher_type, index_policy>::
+findSlot(const size_t i, const key_type &key, const uint32_t tag) const {
+    // bits above the first match may be spurious and may even mark a free entry holding a stale key
+    for (uint64_t match = matchTags(i, tag); match; match &= match - 1) {
+        size_t j = lane(match);
+        if (buckets_[i].tags[j] == tag && buckets_[i].keys[j] == key) {
+            return j;
+        }
+    }
+    return entries_per_bucket;
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+size_t CuckooMap<key_type, value_type, hasher_type, index_policy>::
+findStashed(const key_type &key, const uint32_t tag, const size_t i1, const size_t i2) const {
+    size_t size = stash_size_.load(std::memory_order_relaxed);
+    for (size_t k = 0; k < size; k++) {
+        const StashEntry &entry = stash_[k];
+        if (entry.tag == tag && (entry.index == i1 || entry.index == i2) && entry.key == key) {
+            return k;
+        }
+    }
+    return size;
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+void CuckooMap<key_type, value_type, hasher_type, index_policy>::
+store(const size_t i, const size_t slot, const key_type &key, const value_type &value, const uint32_t tag) {
+    buckets_[i].keys[slot] = key;
+    buckets_[i].values[slot] = value;
+    buckets_[i].tags[slot] = (uint8_t) tag;
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+bool CuckooMap<key_type, value_type, hasher_type, index_policy>::
+place(const key_type &key, const value_type &value, const uint32_t tag, const size_t i1, const size_t i2) {
+    for (size_t i : {i1, i2}) {
+        uint64_t free = matchTags(i, 0);
+        if (free) {
+            beginWrite(i);
+            store(i, lane(free), key, value, tag);
+            endWrite(i);
+            return true;
+        }
+    }
+
+    // random walk from the secondary bucket, nothing is moved until a free slot is found
+    PathStep path[KICKS_MAX_COUNT];
+    size_t length = 0;
+    size_t curr_index = i2;
+    size_t free_slot = entries_per_bucket;
+    for (size_t kicks = 0; kicks < KICKS_MAX_COUNT; kicks++) {
+        size_t slot = rand() % entries_per_bucket;
+        // a slot visited twice would be moved twice, the cycle since its first visit is cut off
+        for (size_t k = 0; k < length; k++) {
+            if (path[k].bucket == curr_index && path[k].slot == slot) {
+                length = k;
+                break;
+            }
+        }
+        path[length++] = {curr_index, slot};
+        curr_index = index_policy_.alternate(curr_index, buckets_[curr_index].tags[slot]);
+        uint64_t free = matchTags(curr_index, 0);
+        if (free) {
+            free_slot = lane(free);
+            break;
+        }
+    }
+    if (free_slot == entries_per_bucket) {
+        return false;
+    }
+
+    // moving entries backwards, every entry is in one of its buckets at any time
+    size_t to_bucket = curr_index;
+    size_t to_slot = free_slot;
+    for (size_t k = length; k-- > 0;) {
+        const PathStep &from = path[k];
+        Bucket &bucket = buckets_[from.bucket];
+        beginWrite(to_bucket);
+        store(to_bucket, to_slot, bucket.keys[from.slot], bucket.values[from.slot], bucket.tags[from.slot]);
+        endWrite(to_bucket);
+        to_bucket = from.bucket;
+        to_slot = from.slot;
+    }
+    // the first step's slot still holds a copy of the moved entry, overwriting it removes that copy
+    beginWrite(to_bucket);
+    store(to_bucket, to_slot, key, value, tag);
+    endWrite(to_bucket);
+    return true;
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+void CuckooMap<key_type, value_type, hasher_type, index_policy>::drainStash() {
+    for (size_t k = 0; k < stash_size_.load(std::memory_order_relaxed);) {
+        StashEntry entry = stash_[k];
+        // the entry is visible in the stash until it is visible in the table
+        if (!place(entry.key, entry.value, entry.tag, entry.index,
+                   index_policy_.alternate(entry.index, entry.tag))) {
+            k++;
+            continue;
+        }
+        size_t last = stash_size_.load(std::memory_order_relaxed) - 1;
+        stash_version_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        stash_[k] = stash_[last];
+        stash_size_.store(last, std::memory_order_relaxed);
+        stash_version_.fetch_add(1, std::memory_order_release);
+    }
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+InsertStatus CuckooMap<key_type, value_type, hasher_type, index_policy>::
+insert(const key_type &key, const value_type &value) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    uint32_t tag;
+    size_t i1;
+    firstPass(hash_function_.hash(key), &tag, &i1);
+    size_t i2 = index_policy_.alternate(i1, tag);
+
+    for (size_t i : {i1, i2}) {
+        size_t slot = findSlot(i, key, tag);
+        if (slot != entries_per_bucket) {
+            beginWrite(i);
+            buckets_[i].values[slot] = value;
+            endWrite(i);
+            return InsertStatus::AlreadyPresent;
+        }
+    }
+    size_t stashed = findStashed(key, tag, i1, i2);
+    if (stashed != stash_size_.load(std::memory_order_relaxed)) {
+        stash_version_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        stash_[stashed].value = value;
+        stash_version_.fetch_add(1, std::memory_order_release);
+        return InsertStatus::AlreadyPresent;
+    }
+
+    if (place(key, value, tag, i1, i2)) {
+        element_count_.fetch_add(1, std::memory_order_relaxed);
+        return InsertStatus::Inserted;
+    }
+
+    size_t size = stash_size_.load(std::memory_order_relaxed);
+    if (size == stash_capacity_) {
+        return InsertStatus::RejectedFull;
+    }
+    stash_version_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    stash_[size] = {key, value, tag, i1};
+    stash_size_.store(size + 1, std::memory_order_relaxed);
+    stash_version_.fetch_add(1, std::memory_order_release);
+    element_count_.fetch_add(1, std::memory_order_relaxed);
+    return InsertStatus::Stashed;
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+bool CuckooMap<key_type, value_type, hasher_type, index_policy>::erase(const key_type &key) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    uint32_t tag;
+    size_t i1;
+    firstPass(hash_function_.hash(key), &tag, &i1);
+    size_t i2 = index_policy_.alternate(i1, tag);
+
+    bool erased = false;
+    for (size_t i : {i1, i2}) {
+        size_t slot = findSlot(i, key, tag);
+        if (slot != entries_per_bucket) {
+            beginWrite(i);
+            buckets_[i].tags[slot] = 0;
+            endWrite(i);
+            erased = true;
+            break;
+        }
+    }
+    if (!erased) {
+        size_t size = stash_size_.load(std::memory_order_relaxed);
+        size_t stashed = findStashed(key, tag, i1, i2);
+        if (stashed == size) {
+            return false;
+        }
+        stash_version_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        stash_[stashed] = stash_[size - 1];
+        stash_size_.store(size - 1, std::memory_order_relaxed);
+        stash_version_.fetch_add(1, std::memory_order_release);
+    }
+    element_count_.fetch_sub(1, std::memory_order_relaxed);
+
+    if (stash_size_.load(std::memory_order_relaxed) > 0) {
+        drainStash();
+    }
+    return true;
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+bool CuckooMap<key_type, value_type, hasher_type, index_policy>::find(const key_type &key, value_type &value) const {
+    uint32_t tag;
+    size_t i1;
+    firstPass(hash_function_.hash(key), &tag, &i1);
+    const size_t i2 = index_policy_.alternate(i1, tag);
+    std::atomic<uint32_t> &version1 = version(i1);
+    std::atomic<uint32_t> &version2 = version(i2);
+
+    while (true) {
+        uint32_t v1 = version1.load(std::memory_order_acquire);
+        uint32_t v2 = version2.load(std::memory_order_acquire);
+        uint32_t vs = stash_version_.load(std::memory_order_acquire);
+        if ((v1 | v2 | vs) & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // candidate value is copied before validation, a torn copy is discarded below
+        bool found = false;
+        value_type candidate;
+        for (size_t i : {i1, i2}) {
+            size_t slot = findSlot(i, key, tag);
+            if (slot != entries_per_bucket) {
+                candidate = buckets_[i].values[slot];
+                found = true;
+                break;
+            }
+        }
+        if (!found && stash_size_.load(std::memory_order_relaxed) > 0) {
+            size_t stashed = findStashed(key, tag, i1, i2);
+            if (stashed != stash_size_.load(std::memory_order_relaxed)) {
+                candidate = stash_[stashed].value;
+                found = true;
+            }
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (version1.load(std::memory_order_relaxed) == v1 && version2.load(std::memory_order_relaxed) == v2 &&
+            stash_version_.load(std::memory_order_relaxed) == vs) {
+            if (found) {
+                value = candidate;
+            }
+            return found;
+        }
+    }
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+bool CuckooMap<key_type, value_type, hasher_type, index_policy>::contains(const key_type &key) const {
+    value_type value;
+    return find(key, value);
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+size_t CuckooMap<key_type, value_type, hasher_type, index_policy>::getElementCount() const {
+    return element_count_.load(std::memory_order_relaxed);
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+double CuckooMap<key_type, value_type, hasher_type, index_policy>::getLoadFactor() const {
+    size_t stored = getElementCount() - getStashSize();
+    return stored / ((double) table_size_ * entries_per_bucket);
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+size_t CuckooMap<key_type, value_type, hasher_type, index_policy>::getTableSize() const {
+    return table_size_;
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+size_t CuckooMap<key_type, value_type, hasher_type, index_policy>::getTableBytes() const {
+    return table_size_ * sizeof(Bucket);
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+size_t CuckooMap<key_type, value_type, hasher_type, index_policy>::getStashSize() const {
+    return stash_size_.load(std::memory_order_relaxed);
+}
+
+
+template<typename key_type, typename value_type, typename hasher_type, typename index_policy>
+uint64_t CuckooMap<key_type, value_type, hasher_type, index_policy>::getSeed() const {
+    return hash_function_.getSeed();
+}
+
+#endif
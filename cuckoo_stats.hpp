@@ -0,0 +1,391 @@
+#ifndef CUCKOOFILTER_CUCKOO_STATS_H
+#define CUCKOOFILTER_CUCKOO_STATS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+
+// Statistics are collected only when compiled with -DCUCKOO_FILTER_STATS, otherwise every
+// CF_STATS statement is removed by the preprocessor.
+#ifdef CUCKOO_FILTER_STATS
+#define CF_STATS(statement) do { statement; } while (0)
+#else
+#define CF_STATS(statement) do { } while (0)
+#endif
+
+// kick counts below are recorded exactly, larger ones in 4 sub-buckets per power of two
+#define KICK_HISTOGRAM_LINEAR 4
+#define KICK_HISTOGRAM_SIZE 64
+
+
+/**
+ * Counter written by one thread and read by others. The owning thread increments it with a relaxed load and
+ * store, which compiles to a plain increment, readers load it relaxed, so neither side races.
+ */
+class StatCounter {
+
+private:
+    std::atomic<uint64_t> value_;
+
+public:
+
+    StatCounter() : value_(0) {
+    }
+
+    StatCounter(const StatCounter &other) : value_(other.load()) {
+    }
+
+    StatCounter &operator=(const StatCounter &other) {
+        value_.store(other.load(), std::memory_order_relaxed);
+        return *this;
+    }
+
+    StatCounter &operator=(const uint64_t value) {
+        value_.store(value, std::memory_order_relaxed);
+        return *this;
+    }
+
+    /**
+     * Adding to the counter, only by its owning thread or on a copy.
+     */
+    StatCounter &operator+=(const uint64_t delta) {
+        value_.store(load() + delta, std::memory_order_relaxed);
+        return *this;
+    }
+
+    StatCounter &operator-=(const uint64_t delta) {
+        value_.store(load() - delta, std::memory_order_relaxed);
+        return *this;
+    }
+
+    StatCounter &operator++(int) {
+        return *this += 1;
+    }
+
+    uint64_t load() const {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+    operator uint64_t() const {
+        return load();
+    }
+};
+
+
+/**
+ * Counters describing how insertions, lookups and deletions behave. Kick chain lengths are recorded in
+ * a log-linear histogram with relative error below 25%.
+ */
+struct FilterStats {
+    // insertions of new elements, including rejected ones
+    StatCounter insertions;
+    // insertions rejected by full stash or admission hook
+    StatCounter rejected;
+    // insertions whose kick chain failed and ended in the stash
+    StatCounter stashed;
+    // stashed fingerprints moved back to the table after a deletion
+    StatCounter stash_drains;
+    // number of insertions by number of kicked fingerprints
+    StatCounter kick_histogram[KICK_HISTOGRAM_SIZE];
+
+    // lookups and their outcome
+    StatCounter lookups;
+    StatCounter lookup_hits;
+    // lookups answered by the primary bucket without touching the secondary one
+    StatCounter first_bucket_hits;
+    // lookups answered by the stash
+    StatCounter stash_hits;
+
+    // deletions and their outcome
+    StatCounter deletions;
+    StatCounter deletion_hits;
+
+    FilterStats();
+
+    /**
+     * Setting all counters to zero.
+     */
+    void reset();
+
+    /**
+     * Recording a finished insertion.
+     *
+     * @param kicks Number of fingerprints kicked during the insertion
+     */
+    void recordKicks(size_t kicks);
+
+    /**
+     * Estimating kick chain length below which fraction q of insertions finished.
+     *
+     * @param q Quantile between 0 and 1
+     * @return Upper bound of the histogram bucket containing the quantile
+     */
+    size_t kickQuantile(double q) const;
+
+    /**
+     * Adding counters of another instance, used for aggregating per-thread statistics.
+     *
+     * @param other Statistics to add
+     * @return This instance
+     */
+    FilterStats &operator+=(const FilterStats &other);
+
+    /**
+     * Subtracting counters of an earlier snapshot of the same counters.
+     *
+     * @param other Statistics to subtract
+     * @return This instance
+     */
+    FilterStats &operator-=(const FilterStats &other);
+
+    /**
+     * Formatting counters as human readable text, one counter per line.
+     *
+     * @return Text representation
+     */
+    std::string toString() const;
+
+    /**
+     * Mapping kick count to histogram bucket.
+     *
+     * @param kicks Number of kicks
+     * @return Bucket index
+     */
+    static size_t kickBucket(size_t kicks);
+
+    /**
+     * Smallest kick count mapped to histogram bucket.
+     *
+     * @param bucket Bucket index
+     * @return Lower bound of the bucket
+     */
+    static size_t kickBucketLowerBound(size_t bucket);
+};
+
+
+inline FilterStats::FilterStats() {
+    reset();
+}
+
+
+inline void FilterStats::reset() {
+    insertions = 0;
+    rejected = 0;
+    stashed = 0;
+    stash_drains = 0;
+    for (size_t b = 0; b < KICK_HISTOGRAM_SIZE; b++) {
+        kick_histogram[b] = 0;
+    }
+    lookups = 0;
+    lookup_hits = 0;
+    first_bucket_hits = 0;
+    stash_hits = 0;
+    deletions = 0;
+    deletion_hits = 0;
+}
+
+
+inline size_t FilterStats::kickBucket(const size_t kicks) {
+    if (kicks < KICK_HISTOGRAM_LINEAR) {
+        return kicks;
+    }
+    size_t exponent = 63 - __builtin_clzll(kicks);
+    size_t sub = (kicks >> (exponent - 2)) & 3;
+    size_t bucket = KICK_HISTOGRAM_LINEAR + (exponent - 2) * 4 + sub;
+    return bucket < KICK_HISTOGRAM_SIZE ? bucket : KICK_HISTOGRAM_SIZE - 1;
+}
+
+
+inline size_t FilterStats::kickBucketLowerBound(const size_t bucket) {
+    if (bucket < KICK_HISTOGRAM_LINEAR) {
+        return bucket;
+    }
+    size_t exponent = (bucket - KICK_HISTOGRAM_LINEAR) / 4 + 2;
+    size_t sub = (bucket - KICK_HISTOGRAM_LINEAR) % 4;
+    return (4 + sub) << (exponent - 2);
+}
+
+
+inline void FilterStats::recordKicks(const size_t kicks) {
+    kick_histogram[kickBucket(kicks)]++;
+}
+
+
+inline size_t FilterStats::kickQuantile(const double q) const {
+    uint64_t total = 0;
+    for (size_t b = 0; b < KICK_HISTOGRAM_SIZE; b++) {
+        total += kick_histogram[b];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t) (q * total);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < KICK_HISTOGRAM_SIZE; b++) {
+        seen += kick_histogram[b];
+        if (seen > rank) {
+            return b + 1 < KICK_HISTOGRAM_SIZE ? kickBucketLowerBound(b + 1) - 1 : kickBucketLowerBound(b);
+        }
+    }
+    return kickBucketLowerBound(KICK_HISTOGRAM_SIZE - 1);
+}
+
+
+inline FilterStats &FilterStats::operator+=(const FilterStats &other) {
+    insertions += other.insertions;
+    rejected += other.rejected;
+    stashed += other.stashed;
+    stash_drains += other.stash_drains;
+    for (size_t b = 0; b < KICK_HISTOGRAM_SIZE; b++) {
+        kick_histogram[b] += other.kick_histogram[b];
+    }
+    lookups += other.lookups;
+    lookup_hits += other.lookup_hits;
+    first_bucket_hits += other.first_bucket_hits;
+    stash_hits += other.stash_hits;
+    deletions += other.deletions;
+    deletion_hits += other.deletion_hits;
+    return *this;
+}
+
+
+inline FilterStats &FilterStats::operator-=(const FilterStats &other) {
+    insertions -= other.insertions;
+    rejected -= other.rejected;
+    stashed -= other.stashed;
+    stash_drains -= other.stash_drains;
+    for (size_t b = 0; b < KICK_HISTOGRAM_SIZE; b++) {
+        kick_histogram[b] -= other.kick_histogram[b];
+    }
+    lookups -= other.lookups;
+    lookup_hits -= other.lookup_hits;
+    first_bucket_hits -= other.first_bucket_hits;
+    stash_hits -= other.stash_hits;
+    deletions -= other.deletions;
+    deletion_hits -= other.deletion_hits;
+    return *this;
+}
+
+
+inline std::string FilterStats::toString() const {
+    std::ostringstream out;
+    out << "insertions " << insertions << "\n";
+    out << "rejected " << rejected << "\n";
+    out << "stashed " << stashed << "\n";
+    out << "stash_drains " << stash_drains << "\n";
+    out << "kicks_p50 " << kickQuantile(0.5) << "\n";
+    out << "kicks_p99 " << kickQuantile(0.99) << "\n";
+    out << "kicks_p999 " << kickQuantile(0.999) << "\n";
+    for (size_t b = 0; b < KICK_HISTOGRAM_SIZE; b++) {
+        if (kick_histogram[b]) {
+            out << "kicks_ge_" << kickBucketLowerBound(b) << " " << kick_histogram[b] << "\n";
+        }
+    }
+    out << "lookups " << lookups << "\n";
+    out << "lookup_hits " << lookup_hits << "\n";
+    out << "first_bucket_hits " << first_bucket_hits << "\n";
+    out << "stash_hits " << stash_hits << "\n";
+    out << "deletions " << deletions << "\n";
+    out << "deletion_hits " << deletion_hits << "\n";
+    return out.str();
+}
+
+
+/**
+ * Registry of per-thread statistics. Every thread updates only its own counters, other threads only read
+ * them, so recording needs no read-modify-write; counters of exited threads are folded into a retired total.
+ */
+class StatsRegistry {
+
+private:
+    struct ThreadSlot;
+
+    std::mutex mutex_;
+    std::set<ThreadSlot *> live_;
+    FilterStats retired_;
+
+    struct ThreadSlot {
+        // written only by the owning thread
+        FilterStats stats;
+        // counters at the last reset, written only by the registry under its mutex
+        FilterStats baseline;
+
+        ThreadSlot() {
+            StatsRegistry::instance().attach(this);
+        }
+
+        ~ThreadSlot() {
+            StatsRegistry::instance().detach(this);
+        }
+
+        /**
+         * @return Counters recorded since the last reset
+         */
+        FilterStats sinceReset() const {
+            FilterStats delta = stats;
+            delta -= baseline;
+            return delta;
+        }
+    };
+
+    void attach(ThreadSlot *slot) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        live_.insert(slot);
+    }
+
+    void detach(ThreadSlot *slot) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        retired_ += slot->sinceReset();
+        live_.erase(slot);
+    }
+
+public:
+
+    static StatsRegistry &instance() {
+        static StatsRegistry registry;
+        return registry;
+    }
+
+    /**
+     * @return Counters of the calling thread
+     */
+    static FilterStats &local() {
+        static thread_local ThreadSlot slot;
+        return slot.stats;
+    }
+
+    /**
+     * Summing counters of all threads since the last reset. Counters of running threads are read while they
+     * keep counting, so a counter may miss the latest updates, but every update is counted once it is read.
+     *
+     * @return Aggregated statistics
+     */
+    FilterStats collect() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        FilterStats total = retired_;
+        for (ThreadSlot *slot : live_) {
+            total += slot->sinceReset();
+        }
+        return total;
+    }
+
+    /**
+     * Resetting counters of all threads. Counters of running threads are not written, their current values
+     * become the baseline subtracted by collect.
+     */
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        retired_.reset();
+        for (ThreadSlot *slot : live_) {
+            slot->baseline = slot->stats;
+        }
+    }
+};
+
+#endif
@@ -1,3 +1,6 @@
+#ifndef CUCKOOFILTER_CUCKOO_TABLE_H
+#define CUCKOOFILTER_CUCKOO_TABLE_H
+
 #include <iostream>
 #include <string.h>
 #include <stdint.h>
@@ -5,15 +8,23 @@
 #include <type_traits>
 #include <exception>
 #include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <vector>
 
 #include "bit_manager.hpp"
 
+// buckets covered by one bit of the dirty bitmap, the unit of replication deltas
+#define DIRTY_RANGE_BUCKETS 64
+
 
 template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
 class CuckooTable {
 
 private:
     static const size_t bytes_per_bucket = (entries_per_bucket * bits_per_fp) / 8;
+    // buckets are probed with 64-bit loads, extra buckets keep loads of the last bucket inside the allocation
+    static const size_t padding_buckets = (sizeof(uint64_t) + bytes_per_bucket - 1) / bytes_per_bucket;
     // number of buckets
     size_t table_size;
     // mask for extracting lower bits
@@ -29,6 +40,34 @@ private:
     // element storage
     Bucket *buckets;
 
+    // number of ranges of DIRTY_RANGE_BUCKETS buckets, the last one may be shorter
+    size_t range_count;
+
+    // one bit per bucket range, set by every store into the range until taken by takeDirtyRanges,
+    // null until enableDirtyTracking is called, so tables which are not replicated do not pay for it
+    std::atomic<uint64_t> *dirty;
+
+    /**
+     * Marking the range of bucket i as changed.
+     */
+    inline void markDirty(size_t i);
+
+    /**
+     * Loading bucket i as 64-bit word, entry j occupies bits_per_fp bits from bit j * bits_per_fp.
+     * Bits above the bucket belong to the following buckets.
+     */
+    inline uint64_t loadBucket(size_t i) const;
+
+    /**
+     * Storing the lower bytes_per_bucket bytes of word to bucket i, following buckets are not written.
+     */
+    inline void storeBucket(size_t i, uint64_t word);
+
+    /**
+     * Index of the first entry marked in match mask of BitManager::matchMask.
+     */
+    inline static size_t firstMatch(uint64_t mask);
+
 public:
 
     /**
@@ -54,6 +93,14 @@ public:
      */
     size_t getTableSize();
 
+    /**
+     * Returning number of buckets a bucket load may reach into, the loaded bucket included. Threads storing
+     * into disjoint bucket ranges must leave that many buckets at the end of each range alone.
+     *
+     * @return Number of buckets covered by a 64-bit load
+     */
+    static size_t getPaddingBuckets();
+
     /**
      * Returning maximum number of elements stored in table.
      *
@@ -110,6 +157,26 @@ public:
      */
     bool replacingFingerprintInsertion(size_t i, uint32_t fp, bool eject, uint32_t &prev_fp);
 
+    /**
+     * Storing fingerprint in the first free entry of bucket i1 or i2 unless either of them already contains
+     * it. Both buckets are loaded once for the test and the insertion.
+     *
+     * @param i1 First bucket index
+     * @param i2 Second bucket index
+     * @param fp Fingerprint for storing
+     * @param present Set to true if fingerprint was already contained
+     * @return True if fingerprint is contained or stored, false if it is absent and both buckets are full
+     */
+    bool insertIfAbsent(size_t i1, size_t i2, uint32_t fp, bool &present);
+
+    /**
+     * Hinting the processor to load bucket i into cache ahead of its use.
+     *
+     * @param i Bucket index
+     * @param write True if bucket is going to be modified
+     */
+    void prefetchBucket(size_t i, bool write) const;
+
     /**
      * Checking if bucket i contains fingerprint fp
      *
@@ -129,6 +196,57 @@ public:
      */
     bool containsFingerprint(size_t i1, size_t i2, uint32_t fp);
 
+    /**
+     * Finding entry of bucket i1, or of bucket i2 if i1 does not contain it, whose bits under key_mask are
+     * equal to fp. The remaining bits of an entry carry a payload, see PayloadFilter.
+     *
+     * @param i1 First bucket index
+     * @param i2 Second bucket index
+     * @param fp Fingerprint to find, bits outside of key_mask must be 0
+     * @param key_mask Mask of fingerprint bits within an entry
+     * @param entry Set to the whole matching entry
+     * @param index Set to index of bucket holding the entry
+     * @return True if a matching entry is found
+     */
+    bool findEntry(size_t i1, size_t i2, uint32_t fp, uint32_t key_mask, uint32_t &entry, size_t &index);
+
+    /**
+     * Finding entry of bucket i1 or i2 whose bits under key_mask are equal to fp and which is accepted by
+     * predicate accept, entries rejected by it are skipped.
+     *
+     * @param i1 First bucket index
+     * @param i2 Second bucket index
+     * @param fp Fingerprint to find, bits outside of key_mask must be 0
+     * @param key_mask Mask of fingerprint bits within an entry
+     * @param accept Functor taking a whole entry, returning false for entries to skip
+     * @param entry Set to the whole matching entry
+     * @param index Set to index of bucket holding the entry
+     * @return True if an accepted matching entry is found
+     */
+    template<typename predicate>
+    bool findEntry(size_t i1, size_t i2, uint32_t fp, uint32_t key_mask, predicate accept, uint32_t &entry,
+                   size_t &index);
+
+    /**
+     * Clearing every stored entry of bucket i for which predicate clear returns true, e.g. expired entries
+     * of WindowedFilter. The bucket is loaded and stored once.
+     *
+     * @param i Bucket index
+     * @param clear Functor taking a whole non-zero entry
+     * @return Number of cleared entries
+     */
+    template<typename predicate>
+    size_t clearEntries(size_t i, predicate clear);
+
+    /**
+     * Calling visit(entry) for every non-zero entry of bucket i, the bucket is loaded once.
+     *
+     * @param i Bucket index
+     * @param visit Functor taking uint32_t entry
+     */
+    template<typename visitor>
+    void forEachEntry(size_t i, visitor visit);
+
     /**
      * Deleting fingerprint from table. If fingerprint is not presented in certain bucket, returning false.
      *
@@ -137,6 +255,69 @@ public:
      * @return True if element is deleted
      */
     bool deleteFingerprint(uint32_t fp, size_t i);
+
+    /**
+     * Deleting fingerprint from bucket i1, or from bucket i2 if i1 does not contain it. Both buckets are
+     * loaded together, so their cache misses overlap.
+     *
+     * @param fp Fingerprint for deletion
+     * @param i1 First bucket index
+     * @param i2 Second bucket index
+     * @param freed Set to index of bucket the fingerprint was deleted from
+     * @return True if element is deleted
+     */
+    bool deleteFingerprint(uint32_t fp, size_t i1, size_t i2, size_t &freed);
+
+    /**
+     * Returning number of bucket ranges tracked by the dirty bitmap.
+     *
+     * @return Number of ranges of DIRTY_RANGE_BUCKETS buckets
+     */
+    size_t getRangeCount();
+
+    /**
+     * Returning size of a bucket range in bytes, only the last range may be shorter.
+     *
+     * @param range Range index
+     * @return Number of bytes of the range's buckets
+     */
+    size_t getRangeBytes(size_t range);
+
+    /**
+     * Starting to track which bucket ranges are written. Stores before the first call are not tracked,
+     * further calls have no effect.
+     */
+    void enableDirtyTracking();
+
+    /**
+     * @return True if enableDirtyTracking was called
+     */
+    bool isDirtyTracking() const;
+
+    /**
+     * Collecting ranges changed since the previous call and clearing their dirty bits. Stores running
+     * concurrently are either reported now or by the next call.
+     *
+     * @return Indices of changed ranges, ascending, empty if tracking is not enabled
+     */
+    std::vector<size_t> takeDirtyRanges();
+
+    /**
+     * Copying the buckets of a range.
+     *
+     * @param range Range index
+     * @param out Destination of getRangeBytes(range) bytes
+     */
+    void readRange(size_t range, uint8_t *out);
+
+    /**
+     * Overwriting the buckets of a range with bytes read by readRange from a table of the same geometry.
+     * The range is marked as changed, so replicas can be chained.
+     *
+     * @param range Range index
+     * @param in Source of getRangeBytes(range) bytes
+     */
+    void writeRange(size_t range, const uint8_t *in);
 };
 
 
@@ -145,8 +326,11 @@ CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::CuckooTable(const size_t
     this->table_size = table_size;
     this->fp_mask = fp_mask;
 
-    buckets = new Bucket[table_size];
-    memset(buckets, 0, bytes_per_bucket * table_size);
+    buckets = new Bucket[table_size + padding_buckets];
+    memset(buckets, 0, bytes_per_bucket * (table_size + padding_buckets));
+
+    range_count = (table_size + DIRTY_RANGE_BUCKETS - 1) / DIRTY_RANGE_BUCKETS;
+    dirty = nullptr;
 
     if (entries_per_bucket == 4 && bits_per_fp == 4 && std::is_same<fp_type, uint8_t>::value) {
         bit_manager = new BitManager4<fp_type>();
@@ -174,6 +358,7 @@ CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::CuckooTable(const size_t
 template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
 CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::~CuckooTable() {
     delete[] buckets;
+    delete[] dirty;
     delete bit_manager;
 }
 
@@ -184,12 +369,55 @@ size_t CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::getTableSize() {
 }
 
 
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+size_t CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::getPaddingBuckets() {
+    return padding_buckets;
+}
+
+
 template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
 size_t CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::maxNoOfElements() {
     return entries_per_bucket * table_size;
 }
 
 
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+inline uint64_t CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::loadBucket(const size_t i) const {
+    uint64_t word;
+    memcpy(&word, buckets[i].data, sizeof(word));
+    return word;
+}
+
+
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+inline void CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::storeBucket(const size_t i, const uint64_t word) {
+    memcpy(buckets[i].data, &word, bytes_per_bucket);
+    markDirty(i);
+}
+
+
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+inline void CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::markDirty(const size_t i) {
+    if (dirty == nullptr) {
+        return;
+    }
+    size_t range = i / DIRTY_RANGE_BUCKETS;
+    uint64_t bit = 1ULL << (range & 63);
+    std::atomic<uint64_t> &word = dirty[range >> 6];
+    // the bit is usually set already, testing first keeps the atomic read-modify-write off the store path
+    if (!(word.load(std::memory_order_relaxed) & bit)) {
+        word.fetch_or(bit, std::memory_order_relaxed);
+    }
+}
+
+
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+inline size_t CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::firstMatch(const uint64_t mask) {
+    // the lowest set bit is the highest bit of the first matching entry
+    return __builtin_ctzll(mask) / bits_per_fp;
+}
+
+
 template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
 inline uint32_t CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::
 getFingerprint(const size_t i, const size_t j) {
@@ -218,6 +446,7 @@ insertFingerprint(const size_t i, const size_t j, const uint32_t fp) {
     const uint8_t *bucket = buckets[i].data;
     uint32_t efp = fp & fp_mask;
     bit_manager->write(j, bucket, efp);
+    markDirty(i);
 }
 
 
@@ -226,56 +455,232 @@ inline bool
 CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::replacingFingerprintInsertion(const size_t i, const uint32_t fp,
                                                                                      const bool eject,
                                                                                      uint32_t &prev_fp) {
-    for (size_t j = 0; j < entries_per_bucket; j++) {
-        if (getFingerprint(i, j) == 0) {
-            insertFingerprint(i, j, fp);
-            return true;
-        }
+    uint64_t word = loadBucket(i);
+    uint64_t free = bit_manager->matchMask(word, 0);
+
+    if (free) {
+        // a free entry is zero, so xor writes fp into it
+        storeBucket(i, word ^ ((uint64_t) fp << (firstMatch(free) * bits_per_fp)));
+        return true;
     }
 
     if (eject) {
-        size_t next = rand() % entries_per_bucket;
-        prev_fp = getFingerprint(i, next);
-        insertFingerprint(i, next, fp);
+        size_t shift = (rand() % entries_per_bucket) * bits_per_fp;
+        prev_fp = (word >> shift) & fp_mask;
+        storeBucket(i, word ^ ((uint64_t) (prev_fp ^ fp) << shift));
     }
     return false;
 }
 
 
 template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
-bool CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::containsFingerprint(const size_t i, const uint32_t fp) {
+bool CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::insertIfAbsent(const size_t i1, const size_t i2,
+                                                                           const uint32_t fp, bool &present) {
+    uint64_t word1 = loadBucket(i1);
+    uint64_t word2 = loadBucket(i2);
+
+    present = bit_manager->matchMask(word1, fp) || bit_manager->matchMask(word2, fp);
+    if (present) {
+        return true;
+    }
+
+    uint64_t free = bit_manager->matchMask(word1, 0);
+    if (free) {
+        storeBucket(i1, word1 ^ ((uint64_t) fp << (firstMatch(free) * bits_per_fp)));
+        return true;
+    }
+    free = bit_manager->matchMask(word2, 0);
+    if (free) {
+        storeBucket(i2, word2 ^ ((uint64_t) fp << (firstMatch(free) * bits_per_fp)));
+        return true;
+    }
+    return false;
+}
+
+
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+inline void CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::
+prefetchBucket(const size_t i, const bool write) const {
     const uint8_t *bucket = buckets[i].data;
-    uint64_t val = *((uint64_t *) bucket);
+    if (write) {
+        __builtin_prefetch(bucket, 1);
+    } else {
+        __builtin_prefetch(bucket, 0);
+    }
+}
 
-    return bit_manager->hasvalue(val, fp);
+
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+bool CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::containsFingerprint(const size_t i, const uint32_t fp) {
+    return bit_manager->hasvalue(loadBucket(i), fp);
 }
 
 
 template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
 bool CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::containsFingerprint(const size_t i1, const size_t i2,
                                                                                 const uint32_t fp) {
-    const uint8_t *b1 = buckets[i1].data;
-    const uint8_t *b2 = buckets[i2].data;
+    return bit_manager->hasvalue(loadBucket(i1), fp) || bit_manager->hasvalue(loadBucket(i2), fp);
+}
 
-    uint64_t val1 = *((uint64_t *) b1);
-    uint64_t val2 = *((uint64_t *) b2);
 
-    return bit_manager->hasvalue(val1, fp) || bit_manager->hasvalue(val2, fp);
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+bool CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::
+findEntry(const size_t i1, const size_t i2, const uint32_t fp, const uint32_t key_mask, uint32_t &entry,
+          size_t &index) {
+    return findEntry(i1, i2, fp, key_mask, [](uint32_t) { return true; }, entry, index);
 }
 
 
 template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
-bool CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::deleteFingerprint(const uint32_t fp, const size_t i) {
+template<typename predicate>
+bool CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::
+findEntry(const size_t i1, const size_t i2, const uint32_t fp, const uint32_t key_mask, predicate accept,
+          uint32_t &entry, size_t &index) {
+    for (size_t i : {i1, i2}) {
+        uint64_t word = loadBucket(i);
+        // marks above the first one may be spurious, every marked entry is compared again
+        for (uint64_t match = bit_manager->matchMask(word, fp, key_mask); match; match &= match - 1) {
+            uint32_t candidate = (word >> (firstMatch(match) * bits_per_fp)) & fp_mask;
+            if ((candidate & key_mask) == fp && accept(candidate)) {
+                entry = candidate;
+                index = i;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+template<typename predicate>
+size_t CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::clearEntries(const size_t i, predicate clear) {
+    uint64_t word = loadBucket(i);
+    size_t cleared = 0;
     for (size_t j = 0; j < entries_per_bucket; j++) {
-        if (getFingerprint(i, j) == fp) {
-            insertFingerprint(i, j, 0);
-            return true;
+        uint32_t entry = (word >> (j * bits_per_fp)) & fp_mask;
+        if (entry != 0 && clear(entry)) {
+            word ^= (uint64_t) entry << (j * bits_per_fp);
+            cleared++;
         }
     }
+    if (cleared) {
+        storeBucket(i, word);
+    }
+    return cleared;
+}
+
+
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+template<typename visitor>
+void CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::forEachEntry(const size_t i, visitor visit) {
+    uint64_t word = loadBucket(i);
+    for (size_t j = 0; j < entries_per_bucket; j++) {
+        uint32_t entry = (word >> (j * bits_per_fp)) & fp_mask;
+        if (entry != 0) {
+            visit(entry);
+        }
+    }
+}
+
+
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+bool CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::deleteFingerprint(const uint32_t fp, const size_t i) {
+    uint64_t word = loadBucket(i);
+    uint64_t match = bit_manager->matchMask(word, fp);
+    if (!match) {
+        return false;
+    }
+    // xor clears the matching entry
+    storeBucket(i, word ^ ((uint64_t) fp << (firstMatch(match) * bits_per_fp)));
+    return true;
+}
+
+
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+bool CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::deleteFingerprint(const uint32_t fp, const size_t i1,
+                                                                              const size_t i2, size_t &freed) {
+    uint64_t word1 = loadBucket(i1);
+    uint64_t word2 = loadBucket(i2);
+
+    uint64_t match = bit_manager->matchMask(word1, fp);
+    if (match) {
+        storeBucket(i1, word1 ^ ((uint64_t) fp << (firstMatch(match) * bits_per_fp)));
+        freed = i1;
+        return true;
+    }
+    match = bit_manager->matchMask(word2, fp);
+    if (match) {
+        storeBucket(i2, word2 ^ ((uint64_t) fp << (firstMatch(match) * bits_per_fp)));
+        freed = i2;
+        return true;
+    }
     return false;
 }
 
 
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+size_t CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::getRangeCount() {
+    return range_count;
+}
+
+
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+size_t CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::getRangeBytes(const size_t range) {
+    size_t first = range * DIRTY_RANGE_BUCKETS;
+    return (std::min(table_size, first + DIRTY_RANGE_BUCKETS) - first) * bytes_per_bucket;
+}
+
+
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+void CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::enableDirtyTracking() {
+    if (dirty != nullptr) {
+        return;
+    }
+    dirty = new std::atomic<uint64_t>[(range_count + 63) / 64];
+    for (size_t w = 0; w < (range_count + 63) / 64; w++) {
+        dirty[w].store(0, std::memory_order_relaxed);
+    }
+}
+
+
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+bool CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::isDirtyTracking() const {
+    return dirty != nullptr;
+}
+
+
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+std::vector<size_t> CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::takeDirtyRanges() {
+    std::vector<size_t> ranges;
+    if (dirty == nullptr) {
+        return ranges;
+    }
+    for (size_t w = 0; w < (range_count + 63) / 64; w++) {
+        if (dirty[w].load(std::memory_order_relaxed) == 0) {
+            continue;
+        }
+        for (uint64_t bits = dirty[w].exchange(0, std::memory_order_acquire); bits; bits &= bits - 1) {
+            ranges.push_back(w * 64 + __builtin_ctzll(bits));
+        }
+    }
+    return ranges;
+}
+
+
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+void CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::readRange(const size_t range, uint8_t *out) {
+    memcpy(out, buckets[range * DIRTY_RANGE_BUCKETS].data, getRangeBytes(range));
+}
+
+
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+void CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::writeRange(const size_t range, const uint8_t *in) {
+    memcpy(buckets[range * DIRTY_RANGE_BUCKETS].data, in, getRangeBytes(range));
+    markDirty(range * DIRTY_RANGE_BUCKETS);
+}
+
+
 template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
 size_t CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::
 getNumOfFreeEntries() {
@@ -303,4 +708,6 @@ void CuckooTable<entries_per_bucket, bits_per_fp, fp_type>::printTable() {
         std::cout << std::endl;
     }
     std::cout << std::dec;
-}
\ No newline at end of file
+}
+
+#endif
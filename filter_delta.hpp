@@ -0,0 +1,219 @@
+#ifndef CUCKOOFILTER_FILTER_DELTA_H
+#define CUCKOOFILTER_FILTER_DELTA_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "cuckoo_table.hpp"
+#include "util.h"
+#include "victim_stash.hpp"
+
+// first bytes of every delta, the trailing digit is the format version
+#define DELTA_MAGIC "CFDELTA1"
+// digits of the sequence number in delta file names, so that files sort in sequence order
+#define DELTA_SEQUENCE_DIGITS 20
+
+
+/**
+ * Changes of a filter since its previous delta, extracted by CuckooFilter::extractDelta and applied to a
+ * replica of the same geometry and seed by CuckooFilter::applyDelta. The table is shipped as whole ranges of
+ * DIRTY_RANGE_BUCKETS buckets which were written to, the element count and the stash are small and shipped
+ * whole by every delta.
+ */
+struct FilterDelta {
+    // position in the sequence of deltas of the primary, the first delta is 1
+    uint64_t sequence = 0;
+    // true if every range is included, a replica at any sequence can apply it
+    bool snapshot = false;
+    // hash seed of the primary
+    uint64_t seed = 0;
+    // number of buckets of the primary
+    uint64_t table_size = 0;
+    // template parameters of the primary's table
+    uint32_t entries_per_bucket = 0;
+    uint32_t bits_per_fp = 0;
+    // number of fingerprints stored in the table
+    uint64_t element_count = 0;
+    // stashed fingerprints with their bucket indices
+    std::vector<Victim> stash;
+    // indices of included bucket ranges, ascending
+    std::vector<uint64_t> ranges;
+    // bucket bytes of the included ranges, concatenated in order of ranges
+    std::vector<uint8_t> data;
+};
+
+
+template<typename value_type>
+inline void writeValue(std::ostream &out, const value_type value) {
+    out.write((const char *) &value, sizeof(value));
+}
+
+
+template<typename value_type>
+inline bool readValue(std::istream &in, value_type &value) {
+    return (bool) in.read((char *) &value, sizeof(value));
+}
+
+
+/**
+ * Writing delta in binary form, integers in host byte order, so primary and replicas must share the
+ * architecture, as they share the bucket layout anyway.
+ *
+ * @param out Binary output stream
+ * @param delta Delta to write
+ */
+inline void writeDelta(std::ostream &out, const FilterDelta &delta) {
+    out.write(DELTA_MAGIC, sizeof(DELTA_MAGIC) - 1);
+    writeValue<uint64_t>(out, delta.sequence);
+    writeValue<uint8_t>(out, delta.snapshot);
+    writeValue<uint64_t>(out, delta.seed);
+    writeValue<uint64_t>(out, delta.table_size);
+    writeValue<uint32_t>(out, delta.entries_per_bucket);
+    writeValue<uint32_t>(out, delta.bits_per_fp);
+    writeValue<uint64_t>(out, delta.element_count);
+    writeValue<uint64_t>(out, delta.stash.size());
+    for (const Victim &victim : delta.stash) {
+        writeValue<uint32_t>(out, victim.fp);
+        writeValue<uint64_t>(out, victim.index);
+    }
+    writeValue<uint64_t>(out, delta.ranges.size());
+    for (uint64_t range : delta.ranges) {
+        writeValue<uint64_t>(out, range);
+    }
+    writeValue<uint64_t>(out, delta.data.size());
+    out.write((const char *) delta.data.data(), delta.data.size());
+}
+
+
+/**
+ * Reading delta written by writeDelta. Counts read from the stream are checked against the geometry in the
+ * header before anything is allocated, so corrupt or truncated files are rejected rather than exhausting
+ * memory.
+ *
+ * @param in Binary input stream
+ * @param delta Delta to fill
+ * @return False if the stream does not hold a complete and consistent delta
+ */
+inline bool readDelta(std::istream &in, FilterDelta &delta) {
+    char magic[sizeof(DELTA_MAGIC) - 1];
+    if (!in.read(magic, sizeof(magic)) || std::string(magic, sizeof(magic)) != DELTA_MAGIC) {
+        return false;
+    }
+    uint8_t snapshot;
+    uint64_t count;
+    if (!readValue(in, delta.sequence) || !readValue(in, snapshot) || !readValue(in, delta.seed) ||
+        !readValue(in, delta.table_size) || !readValue(in, delta.entries_per_bucket) ||
+        !readValue(in, delta.bits_per_fp) || !readValue(in, delta.element_count) || !readValue(in, count)) {
+        return false;
+    }
+    delta.snapshot = snapshot != 0;
+    // a bucket is probed as one 64-bit word, so it never exceeds 8 bytes
+    const uint64_t bucket_bytes = ((uint64_t) delta.entries_per_bucket * delta.bits_per_fp + 7) / 8;
+    if (delta.table_size == 0 || bucket_bytes == 0 || bucket_bytes > sizeof(uint64_t) || count > STASH_MAX_SIZE) {
+        return false;
+    }
+    const uint64_t range_count = (delta.table_size + DIRTY_RANGE_BUCKETS - 1) / DIRTY_RANGE_BUCKETS;
+
+    delta.stash.clear();
+    for (uint64_t k = 0; k < count; k++) {
+        Victim victim;
+        uint64_t index;
+        if (!readValue(in, victim.fp) || !readValue(in, index)) {
+            return false;
+        }
+        victim.index = index;
+        delta.stash.push_back(victim);
+    }
+
+    if (!readValue(in, count) || count > range_count) {
+        return false;
+    }
+    delta.ranges.clear();
+    for (uint64_t k = 0; k < count; k++) {
+        uint64_t range;
+        if (!readValue(in, range)) {
+            return false;
+        }
+        delta.ranges.push_back(range);
+    }
+
+    if (!readValue(in, count) || count > delta.ranges.size() * DIRTY_RANGE_BUCKETS * bucket_bytes) {
+        return false;
+    }
+    delta.data.resize(count);
+    return (bool) in.read((char *) delta.data.data(), count);
+}
+
+
+/**
+ * @param directory Directory shared by the primary and its replicas
+ * @param sequence Sequence number of the delta
+ * @return Path of the delta file, e.g. directory/delta-00000000000000000042.cfd
+ */
+inline std::string deltaPath(const std::string &directory, const uint64_t sequence) {
+    std::string digits = std::to_string(sequence);
+    return directory + "/delta-" + std::string(DELTA_SEQUENCE_DIGITS - digits.size(), '0') + digits + ".cfd";
+}
+
+
+/**
+ * Saving delta into directory. The delta is written to a temporary file and renamed, so replicas never
+ * read a partially written delta.
+ *
+ * @param delta Delta to save
+ * @param directory Directory shared by the primary and its replicas
+ * @throws std::runtime_error if the file cannot be written
+ */
+inline void saveDelta(const FilterDelta &delta, const std::string &directory) {
+    std::string path = deltaPath(directory, delta.sequence);
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        writeDelta(out, delta);
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("Cannot write delta file " + temporary + ".\n");
+        }
+    }
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Cannot rename delta file to " + path + ".\n");
+    }
+}
+
+
+/**
+ * Loading delta with the given sequence number from directory.
+ *
+ * @param directory Directory shared by the primary and its replicas
+ * @param sequence Sequence number of the delta
+ * @param delta Delta to fill
+ * @return False if the delta is not saved yet or is not complete
+ */
+inline bool loadDelta(const std::string &directory, const uint64_t sequence, FilterDelta &delta) {
+    std::ifstream in(deltaPath(directory, sequence), std::ios::binary);
+    return in && readDelta(in, delta) && delta.sequence == sequence;
+}
+
+
+/**
+ * Applying every delta saved in directory after the current sequence number of replica, in order.
+ *
+ * @tparam filter_type Filter with getSequence and applyDelta, e.g. CuckooFilter
+ * @param replica Replica to bring up to date
+ * @param directory Directory shared by the primary and its replicas
+ * @return Number of applied deltas
+ */
+template<typename filter_type>
+size_t catchUp(filter_type &replica, const std::string &directory) {
+    size_t applied = 0;
+    FilterDelta delta;
+    while (loadDelta(directory, replica.getSequence() + 1, delta) && replica.applyDelta(delta)) {
+        applied++;
+    }
+    return applied;
+}
+
+#endif
@@ -4,64 +4,338 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <functional>
 #include <random>
-#include <iostream>
 #include <string>
-#include <vector>
-#include <tuple>
+#include <string_view>
+#include <type_traits>
 
-#define HASH_A 54059
-#define HASH_B 76963
-#define FIRSTH 37
 static const uint32_t MURMUR_CONST = 0x5bd1e995;
+static const uint64_t MURMUR_CONST_64 = 0xc6a4a7935bd1e995ULL;
 
-// Martin Dietzfelbinger, "Universal hashing and k-wise independent random
-// variables via integer arithmetic without primes".
-class HashFunction {
-private:
-    //unsigned __int128 multiply_, add_;
 
+/**
+ * Non-owning view of a byte range, used as key for raw binary data.
+ */
+struct ByteSpan {
+    const void *data;
+    size_t size;
 
-public: 
+    ByteSpan(const void *data, size_t size) : data(data), size(size) {}
+};
 
-    uint64_t hash(size_t key, size_t num_buckets);
 
-//    uint64_t hash(uint32_t key) const;
+/**
+ * Final mixing step of MurmurHash3, every input bit affects every output bit.
+ *
+ * @param h Value to mix
+ * @return Mixed value
+ */
+inline uint64_t mixHash(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
 
-};
 
+/**
+ * MurmurHash64A by Austin Appleby.
+ *
+ * @param key Start of byte range
+ * @param len Length of byte range
+ * @param seed Hash seed
+ * @return 64-bit hash value
+ */
+inline uint64_t murmurHash64(const void *key, size_t len, uint64_t seed = 0) {
+    const uint8_t *data = (const uint8_t *) key;
+    const uint8_t *end = data + (len & ~((size_t) 7));
+    uint64_t h = seed ^ (len * MURMUR_CONST_64);
+
+    for (; data != end; data += 8) {
+        uint64_t k;
+        memcpy(&k, data, sizeof(k));
+        k *= MURMUR_CONST_64;
+        k ^= k >> 47;
+        k *= MURMUR_CONST_64;
+        h ^= k;
+        h *= MURMUR_CONST_64;
+    }
+
+    switch (len & 7) {
+        case 7: h ^= uint64_t(data[6]) << 48;
+            [[fallthrough]];
+        case 6: h ^= uint64_t(data[5]) << 40;
+            [[fallthrough]];
+        case 5: h ^= uint64_t(data[4]) << 32;
+            [[fallthrough]];
+        case 4: h ^= uint64_t(data[3]) << 24;
+            [[fallthrough]];
+        case 3: h ^= uint64_t(data[2]) << 16;
+            [[fallthrough]];
+        case 2: h ^= uint64_t(data[1]) << 8;
+            [[fallthrough]];
+        case 1: h ^= uint64_t(data[0]);
+            h *= MURMUR_CONST_64;
+    }
+
+    h ^= h >> 47;
+    h *= MURMUR_CONST_64;
+    h ^= h >> 47;
+    return h;
+}
 
 
+#define SIP_ROUND(v0, v1, v2, v3)                                     \
+    do {                                                              \
+        v0 += v1; v1 = (v1 << 13) | (v1 >> 51); v1 ^= v0;             \
+        v0 = (v0 << 32) | (v0 >> 32);                                 \
+        v2 += v3; v3 = (v3 << 16) | (v3 >> 48); v3 ^= v2;             \
+        v0 += v3; v3 = (v3 << 21) | (v3 >> 43); v3 ^= v0;             \
+        v2 += v1; v1 = (v1 << 17) | (v1 >> 47); v1 ^= v2;             \
+        v2 = (v2 << 32) | (v2 >> 32);                                 \
+    } while (0)
+
 /**
- * Hash function for string keys
- * @param key Key of string type
- * @return Hash function for string
+ * SipHash-1-3 by Jean-Philippe Aumasson and Daniel J. Bernstein, a keyed hash whose outputs can not be
+ * predicted without the key, so colliding keys can not be crafted.
+ *
+ * @param key Start of byte range
+ * @param len Length of byte range
+ * @param k0 Lower half of 128-bit secret key
+ * @param k1 Upper half of 128-bit secret key
+ * @return 64-bit hash value
  */
-uint64_t HashFunction::hash(size_t key, size_t num_buckets){
-//    return murmurHash3Function(&key, (size_t) key.size());
-//    return std::hash<std::string>{}(key);
-    unsigned long long key_val = std::hash<size_t>{}(key);
-    uint32_t b = 1, j = 0;
-    while (j < num_buckets) {
-        b = j;
-        key_val = key_val * 2862933555777941757ULL + 1; // Did you say magic number?
-        j = (b + 1) * (double(1LL << 31) / double((key_val >> 33) + 1));
+inline uint64_t sipHash13(const void *key, size_t len, uint64_t k0, uint64_t k1) {
+    const uint8_t *data = (const uint8_t *) key;
+    const uint8_t *end = data + (len & ~((size_t) 7));
+    uint64_t v0 = k0 ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = k1 ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = k0 ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = k1 ^ 0x7465646279746573ULL;
+
+    for (; data != end; data += 8) {
+        uint64_t m;
+        memcpy(&m, data, sizeof(m));
+        v3 ^= m;
+        SIP_ROUND(v0, v1, v2, v3);
+        v0 ^= m;
     }
-    return b;
+
+    uint64_t b = ((uint64_t) len) << 56;
+    switch (len & 7) {
+        case 7: b |= uint64_t(data[6]) << 48;
+            [[fallthrough]];
+        case 6: b |= uint64_t(data[5]) << 40;
+            [[fallthrough]];
+        case 5: b |= uint64_t(data[4]) << 32;
+            [[fallthrough]];
+        case 4: b |= uint64_t(data[3]) << 24;
+            [[fallthrough]];
+        case 3: b |= uint64_t(data[2]) << 16;
+            [[fallthrough]];
+        case 2: b |= uint64_t(data[1]) << 8;
+            [[fallthrough]];
+        case 1: b |= uint64_t(data[0]);
+    }
+    v3 ^= b;
+    SIP_ROUND(v0, v1, v2, v3);
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    SIP_ROUND(v0, v1, v2, v3);
+    SIP_ROUND(v0, v1, v2, v3);
+    SIP_ROUND(v0, v1, v2, v3);
+    return v0 ^ v1 ^ v2 ^ v3;
 }
 
+
+/**
+ * Drawing a seed for a new filter from the system entropy source.
+ *
+ * @return Random 64-bit seed
+ */
+inline uint64_t randomSeed() {
+    std::random_device rd;
+    return (((uint64_t) rd()) << 32) ^ rd();
+}
+
+
+/**
+ * Trait mapping a key to its 64-bit hash value under a seed. Specialize it for own key types, by default
+ * std::hash output is mixed with the seed. Specializations may also omit the seed parameter, their
+ * output is then mixed with the seed by TransparentKeyHash.
+ *
+ * @tparam T Key type
+ */
+template<typename T, typename Enable = void>
+struct KeyHash {
+    uint64_t operator()(const T &key, uint64_t seed = 0) const {
+        return mixHash(std::hash<T>{}(key) ^ seed);
+    }
+};
+
+/**
+ * Integer and enum keys, equal values hash equally regardless of their width.
+ */
+template<typename T>
+struct KeyHash<T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type> {
+    uint64_t operator()(const T key, uint64_t seed = 0) const {
+        return mixHash(((uint64_t) key) ^ seed);
+    }
+};
+
+/**
+ * String keys. All string representations of the same characters hash equally, so a filter of
+ * std::string can be queried with std::string_view or C strings without allocation.
+ */
+template<>
+struct KeyHash<std::string_view> {
+    uint64_t operator()(const std::string_view key, uint64_t seed = 0) const {
+        return murmurHash64(key.data(), key.size(), seed);
+    }
+};
+
+template<>
+struct KeyHash<std::string> {
+    uint64_t operator()(const std::string &key, uint64_t seed = 0) const {
+        return KeyHash<std::string_view>{}(key, seed);
+    }
+};
+
+template<>
+struct KeyHash<const char *> {
+    uint64_t operator()(const char *key, uint64_t seed = 0) const {
+        return KeyHash<std::string_view>{}(key, seed);
+    }
+};
+
+template<>
+struct KeyHash<char *> {
+    uint64_t operator()(const char *key, uint64_t seed = 0) const {
+        return KeyHash<std::string_view>{}(key, seed);
+    }
+};
+
+/**
+ * Raw byte keys, hash equally to strings with the same bytes.
+ */
+template<>
+struct KeyHash<ByteSpan> {
+    uint64_t operator()(const ByteSpan key, uint64_t seed = 0) const {
+        return murmurHash64(key.data, key.size, seed);
+    }
+};
+
+
+/**
+ * Default hasher of Cuckoo Filter. Dispatches on the type of the key passed to each call, which allows
+ * heterogeneous lookup. Fast, the seed spreads keys differently per filter, but outputs are not
+ * unpredictable enough to withstand keys crafted by an attacker.
+ */
+struct TransparentKeyHash {
+    template<typename K>
+    uint64_t operator()(const K &key, const uint64_t seed) const {
+        typedef KeyHash<typename std::decay<K>::type> key_hash;
+        if constexpr (std::is_invocable<const key_hash &, const K &, uint64_t>::value) {
+            return key_hash{}(key, seed);
+        } else {
+            return mixHash(key_hash{}(key) ^ seed);
+        }
+    }
+};
+
+
+/**
+ * Keyed hasher, 128-bit SipHash-1-3 key is derived from the seed. Integer, string and byte keys are hashed
+ * directly. Other keys are reduced by KeyHash first, so only collisions of their KeyHash stay
+ * predictable. Use it when keys are supplied by untrusted parties.
+ */
+struct SipKeyHash {
+    template<typename K>
+    uint64_t operator()(const K &key, const uint64_t seed) const {
+        typedef typename std::decay<K>::type T;
+        const uint64_t k1 = mixHash(seed ^ MURMUR_CONST_64);
+        if constexpr (std::is_integral<T>::value || std::is_enum<T>::value) {
+            const uint64_t value = (uint64_t) key;
+            return sipHash13(&value, sizeof(value), seed, k1);
+        } else if constexpr (std::is_same<T, ByteSpan>::value) {
+            return sipHash13(key.data, key.size, seed, k1);
+        } else if constexpr (std::is_convertible<const K &, std::string_view>::value) {
+            const std::string_view view = key;
+            return sipHash13(view.data(), view.size(), seed, k1);
+        } else {
+            const uint64_t value = KeyHash<T>{}(key);
+            return sipHash13(&value, sizeof(value), seed, k1);
+        }
+    }
+};
+
+
 /**
- * Hash function for integer keys
- * @param key Key of integer type
- * @return Hash function for uint32
+ * Calculating 64-bit hash values of keys with the given hasher and a per-filter seed.
+ *
+ * @tparam hasher_type Functor mapping a key and a seed to 64-bit hash value
  */
-//uint64_t HashFunction::hash(uint32_t key) const {
-//    return (add_ + multiply_ * static_cast<decltype(multiply_)>(key)) >> 64;
-//}
+template<typename hasher_type = TransparentKeyHash>
+class HashFunction {
+private:
+    hasher_type hasher_;
+
+    // selects the hash function out of the hasher's family
+    uint64_t seed_;
+
+public:
+
+    /**
+     * @param seed Hash seed, filters with the same seed store keys equally
+     */
+    explicit HashFunction(uint64_t seed);
+
+    /**
+     * @return Hash seed
+     */
+    uint64_t getSeed() const;
+
+    /**
+     * Hash function for keys of any type supported by the hasher. Hashers which do not take a seed
+     * have their output mixed with the seed.
+     *
+     * @param key Key
+     * @return 64-bit hash value
+     */
+    template<typename key_type>
+    uint64_t hash(const key_type &key) const;
+};
+
+
+template<typename hasher_type>
+HashFunction<hasher_type>::HashFunction(const uint64_t seed) : seed_(seed) {
+}
+
+
+template<typename hasher_type>
+uint64_t HashFunction<hasher_type>::getSeed() const {
+    return seed_;
+}
+
+
+template<typename hasher_type>
+template<typename key_type>
+inline uint64_t HashFunction<hasher_type>::hash(const key_type &key) const {
+    if constexpr (std::is_invocable<const hasher_type &, const key_type &, uint64_t>::value) {
+        return hasher_(key, seed_);
+    } else {
+        return mixHash(hasher_(key) ^ seed_);
+    }
+}
 
 
 inline static uint32_t fingerprintComplement(const size_t index, const uint32_t fp) {
     return index ^ (fp * MURMUR_CONST);
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,290 @@
+#ifndef CUCKOOFILTER_INDEX_POLICY_H
+#define CUCKOOFILTER_INDEX_POLICY_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <stdexcept>
+
+#include "hash_function.hpp"
+#include "util.h"
+
+// load factor the vacuum policy sizes its alternate ranges for
+#define VACUUM_TARGET_LOAD 0.95
+// number of alternate range sizes, fingerprints are assigned to them by their lowest bits
+#define VACUUM_RANGE_CLASSES 4
+
+
+/**
+ * Bucket index scheme of the original Cuckoo Filter. The number of buckets is rounded down to a power of
+ * two, so reducing a hash value to an index is a mask and the alternate index i ^ hash(fp) is its own
+ * inverse.
+ */
+class XorIndexPolicy {
+
+private:
+    size_t mask_;
+
+public:
+
+    /**
+     * @param table_size Number of buckets, a power of two returned by tableSize
+     * @param entries_per_bucket Number of entries in bucket
+     */
+    XorIndexPolicy(size_t table_size, size_t entries_per_bucket);
+
+    /**
+     * Number of buckets used for a requested table size.
+     *
+     * @param max_table_size Maximum number of buckets
+     * @param entries_per_bucket Number of entries in bucket
+     * @return Largest power of two not above max_table_size
+     */
+    static size_t tableSize(size_t max_table_size, size_t entries_per_bucket);
+
+    /**
+     * @return Policy name used in benchmark output
+     */
+    static const char *name();
+
+    /**
+     * @param hash_value 32-bit hash value
+     * @return Primary bucket index
+     */
+    inline size_t index(uint32_t hash_value) const;
+
+    /**
+     * @param index Bucket index of fingerprint
+     * @param fp Fingerprint
+     * @return The other candidate bucket of fingerprint
+     */
+    inline size_t alternate(size_t index, uint32_t fp) const;
+};
+
+
+inline XorIndexPolicy::XorIndexPolicy(const size_t table_size, size_t) : mask_(table_size - 1) {
+}
+
+
+inline size_t XorIndexPolicy::tableSize(const size_t max_table_size, size_t) {
+    return highestPowerOfTwo(max_table_size);
+}
+
+
+inline const char *XorIndexPolicy::name() {
+    return "xor";
+}
+
+
+inline size_t XorIndexPolicy::index(const uint32_t hash_value) const {
+    // equivalent to modulo when number of buckets is a power of two
+    return hash_value & mask_;
+}
+
+
+inline size_t XorIndexPolicy::alternate(const size_t index, const uint32_t fp) const {
+    return fingerprintComplement(index, fp) & mask_;
+}
+
+
+/**
+ * Bucket index scheme for any number of buckets n, so tables can be sized exactly instead of being rounded
+ * down to a power of two. Hash values are reduced to [0, n) by multiplying and shifting (Lemire's fast
+ * range reduction), and the alternate index (h(fp) - i) mod n is its own inverse:
+ * h(fp) - (h(fp) - i) = i (mod n). Costs one multiply more than the xor scheme.
+ */
+class ModularIndexPolicy {
+
+private:
+    size_t table_size_;
+
+    // reduces 32-bit value to [0, table_size_) without division
+    inline size_t reduce(uint32_t value) const;
+
+public:
+
+    /**
+     * @param table_size Number of buckets
+     * @param entries_per_bucket Number of entries in bucket
+     */
+    ModularIndexPolicy(size_t table_size, size_t entries_per_bucket);
+
+    /**
+     * @param max_table_size Maximum number of buckets
+     * @param entries_per_bucket Number of entries in bucket
+     * @return max_table_size, every size is supported
+     */
+    static size_t tableSize(size_t max_table_size, size_t entries_per_bucket);
+
+    /**
+     * @return Policy name used in benchmark output
+     */
+    static const char *name();
+
+    /**
+     * @param hash_value 32-bit hash value
+     * @return Primary bucket index
+     */
+    inline size_t index(uint32_t hash_value) const;
+
+    /**
+     * @param index Bucket index of fingerprint
+     * @param fp Fingerprint
+     * @return The other candidate bucket of fingerprint
+     */
+    inline size_t alternate(size_t index, uint32_t fp) const;
+};
+
+
+inline ModularIndexPolicy::ModularIndexPolicy(const size_t table_size, size_t) : table_size_(table_size) {
+    if (table_size > UINT32_MAX) {
+        throw std::runtime_error("Modular index policy supports at most 2^32 - 1 buckets.\n");
+    }
+}
+
+
+inline size_t ModularIndexPolicy::tableSize(const size_t max_table_size, size_t) {
+    return max_table_size;
+}
+
+
+inline const char *ModularIndexPolicy::name() {
+    return "modular";
+}
+
+
+inline size_t ModularIndexPolicy::reduce(const uint32_t value) const {
+    return (size_t) (((uint64_t) value * table_size_) >> 32);
+}
+
+
+inline size_t ModularIndexPolicy::index(const uint32_t hash_value) const {
+    return reduce(hash_value);
+}
+
+
+inline size_t ModularIndexPolicy::alternate(const size_t index, const uint32_t fp) const {
+    size_t offset = reduce(fp * MURMUR_CONST);
+    // offset - index mod n, both operands are below n
+    return offset >= index ? offset - index : offset + table_size_ - index;
+}
+
+/**
+ * Bucket index scheme of vacuum filters (Wang et al., "Vacuum Filters: More Space-Efficient and Faster
+ * Replacement for Bloom and Cuckoo Filters"). The alternate bucket lies in a small aligned range around the
+ * primary one, i ^ offset(fp) with offset below the range size, so kick chains and lookups stay within a few
+ * pages instead of spanning the whole table. Fingerprints are split into VACUUM_RANGE_CLASSES classes with
+ * ranges of L, L/2, L/4 and L/8 buckets; the smaller ranges give locality, the largest one balances load
+ * between ranges. L/8 is the smallest power of two for which the fullest range of L/8 buckets is expected to
+ * stay below capacity at VACUUM_TARGET_LOAD, so L grows slowly with the table. The number of buckets is any
+ * multiple of L.
+ */
+class VacuumIndexPolicy {
+
+private:
+    size_t table_size_;
+    // offset of fingerprint class k is taken from the top log2(range size) bits of its hash
+    uint32_t shifts_[VACUUM_RANGE_CLASSES];
+
+public:
+
+    /**
+     * @param table_size Number of buckets, a multiple of chunkSize returned by tableSize
+     * @param entries_per_bucket Number of entries in bucket
+     */
+    VacuumIndexPolicy(size_t table_size, size_t entries_per_bucket);
+
+    /**
+     * @param max_table_size Maximum number of buckets
+     * @param entries_per_bucket Number of entries in bucket
+     * @return Largest multiple of the chunk size not above max_table_size
+     */
+    static size_t tableSize(size_t max_table_size, size_t entries_per_bucket);
+
+    /**
+     * Largest alternate range L for a table.
+     *
+     * @param table_size Number of buckets
+     * @param entries_per_bucket Number of entries in bucket
+     * @return Range size in buckets, a power of two
+     */
+    static size_t chunkSize(size_t table_size, size_t entries_per_bucket);
+
+    /**
+     * @return Policy name used in benchmark output
+     */
+    static const char *name();
+
+    /**
+     * @param hash_value 32-bit hash value
+     * @return Primary bucket index
+     */
+    inline size_t index(uint32_t hash_value) const;
+
+    /**
+     * @param index Bucket index of fingerprint
+     * @param fp Fingerprint
+     * @return The other candidate bucket of fingerprint, in the same aligned range as index
+     */
+    inline size_t alternate(size_t index, uint32_t fp) const;
+};
+
+
+inline size_t VacuumIndexPolicy::chunkSize(const size_t table_size, const size_t entries_per_bucket) {
+    // the smallest range is sized for balance, larger classes follow from it
+    size_t range = 4;
+    while (range < table_size && range < (1U << 13)) {
+        // range loads are close to normal, the maximum of c ranges exceeds the mean by sqrt(2 ln c) deviations
+        double capacity = (double) entries_per_bucket * range;
+        double mean = VACUUM_TARGET_LOAD * capacity;
+        double ranges = table_size / (double) range;
+        if (ranges < 2 || mean + sqrt(2 * mean * log(ranges)) <= capacity) {
+            break;
+        }
+        range <<= 1;
+    }
+    // small tables keep at least 8 ranges, so rounding to a multiple of L wastes less than an eighth
+    size_t limit = std::max((size_t) highestPowerOfTwo(table_size / 8), (size_t) 2);
+    return std::min(range << (VACUUM_RANGE_CLASSES - 1), limit);
+}
+
+
+inline VacuumIndexPolicy::VacuumIndexPolicy(const size_t table_size, const size_t entries_per_bucket)
+        : table_size_(table_size) {
+    if (table_size < 2 || table_size > UINT32_MAX) {
+        throw std::runtime_error("Vacuum index policy supports 2 to 2^32 - 1 buckets.\n");
+    }
+    size_t chunk = chunkSize(table_size, entries_per_bucket);
+    for (size_t k = 0; k < VACUUM_RANGE_CLASSES; k++) {
+        size_t range = std::max(chunk >> k, (size_t) 2);
+        shifts_[k] = 32 - __builtin_ctzll(range);
+    }
+}
+
+
+inline size_t VacuumIndexPolicy::tableSize(const size_t max_table_size, const size_t entries_per_bucket) {
+    size_t chunk = chunkSize(max_table_size, entries_per_bucket);
+    return max_table_size / chunk * chunk;
+}
+
+
+inline const char *VacuumIndexPolicy::name() {
+    return "vacuum";
+}
+
+
+inline size_t VacuumIndexPolicy::index(const uint32_t hash_value) const {
+    return (size_t) (((uint64_t) hash_value * table_size_) >> 32);
+}
+
+
+inline size_t VacuumIndexPolicy::alternate(const size_t index, const uint32_t fp) const {
+    uint32_t hv = fp * MURMUR_CONST;
+    size_t offset = hv >> shifts_[fp & (VACUUM_RANGE_CLASSES - 1)];
+    // offset 0 would make both candidate buckets equal
+    offset += (offset == 0);
+    return index ^ offset;
+}
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef CUCKOOFILTER_INTERLEAVED_LOOKUP_H
+#define CUCKOOFILTER_INTERLEAVED_LOOKUP_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdexcept>
+
+#include "cuckoo_filter.hpp"
+
+#define INTERLEAVE_DEFAULT_DEPTH 16
+#define INTERLEAVE_MAX_DEPTH 64
+
+
+/**
+ * Result of a lookup finished by InterleavedLookup.
+ */
+struct LookupCompletion {
+    // tag passed when the lookup was submitted
+    uint64_t tag;
+    bool found;
+};
+
+
+/**
+ * Keeps up to depth lookups of one filter in flight. Submitting a lookup prefetches both of its buckets
+ * and returns at once; the lookup is finished only when the pipeline is full, so its buckets had the
+ * time of depth - 1 other submissions to arrive from memory. Callers with an irregular stream of requests
+ * get the memory-level parallelism of containsHashes without collecting them into arrays.
+ *
+ * Lookups finish in submission order. Like lookups of the filter itself, the engine must not be used while
+ * the filter is modified, and one engine belongs to one thread.
+ *
+ * @tparam filter_type Filter type, a CuckooFilter
+ */
+template<typename filter_type>
+class InterleavedLookup {
+
+private:
+    const filter_type &filter_;
+    size_t depth_;
+
+    // ring buffer of lookups in flight, oldest at head_
+    LookupProbe probes_[INTERLEAVE_MAX_DEPTH];
+    uint64_t tags_[INTERLEAVE_MAX_DEPTH];
+    size_t head_;
+    size_t size_;
+
+    void retire(LookupCompletion *completed);
+
+public:
+
+    /**
+     * @param filter Filter to look up, must outlive the engine
+     * @param depth Maximum number of lookups in flight, between 1 and INTERLEAVE_MAX_DEPTH
+     */
+    explicit InterleavedLookup(const filter_type &filter, size_t depth = INTERLEAVE_DEFAULT_DEPTH);
+
+    /**
+     * Starting lookup of element. If depth lookups are already in flight, the oldest one is finished
+     * first.
+     *
+     * @param element Element to look up
+     * @param tag Value identifying the lookup in its completion
+     * @param completed Set to the finished lookup if true is returned
+     * @return True if a lookup was finished
+     */
+    template<typename key_type>
+    bool submit(const key_type &element, uint64_t tag, LookupCompletion *completed);
+
+    /**
+     * Starting lookup of element given by its precomputed hash value.
+     *
+     * @param hash_value Hash value of the element
+     * @param tag Value identifying the lookup in its completion
+     * @param completed Set to the finished lookup if true is returned
+     * @return True if a lookup was finished
+     */
+    bool submitHash(uint64_t hash_value, uint64_t tag, LookupCompletion *completed);
+
+    /**
+     * Finishing the oldest lookup in flight, call it until it returns false to drain the engine.
+     *
+     * @param completed Set to the finished lookup if true is returned
+     * @return True if a lookup was finished, false if none is in flight
+     */
+    bool flush(LookupCompletion *completed);
+
+    /**
+     * @return Number of lookups in flight
+     */
+    size_t inFlight() const;
+
+    /**
+     * @return Maximum number of lookups in flight
+     */
+    size_t depth() const;
+};
+
+
+template<typename filter_type>
+InterleavedLookup<filter_type>::InterleavedLookup(const filter_type &filter, const size_t depth)
+        : filter_(filter), depth_(depth), head_(0), size_(0) {
+    if (depth == 0 || depth > INTERLEAVE_MAX_DEPTH) {
+        throw std::runtime_error("Interleaved lookup depth must be between 1 and INTERLEAVE_MAX_DEPTH");
+    }
+}
+
+
+template<typename filter_type>
+inline void InterleavedLookup<filter_type>::retire(LookupCompletion *completed) {
+    completed->tag = tags_[head_];
+    completed->found = filter_.endLookup(probes_[head_]);
+    head_ = head_ + 1 == depth_ ? 0 : head_ + 1;
+    size_--;
+}
+
+
+template<typename filter_type>
+template<typename key_type>
+inline bool InterleavedLookup<filter_type>::submit(const key_type &element, const uint64_t tag,
+                                                   LookupCompletion *completed) {
+    bool retired = size_ == depth_;
+    if (retired) {
+        retire(completed);
+    }
+    size_t slot = head_ + size_ < depth_ ? head_ + size_ : head_ + size_ - depth_;
+    probes_[slot] = filter_.beginLookup(element);
+    tags_[slot] = tag;
+    size_++;
+    return retired;
+}
+
+
+template<typename filter_type>
+inline bool InterleavedLookup<filter_type>::submitHash(const uint64_t hash_value, const uint64_t tag,
+                                                       LookupCompletion *completed) {
+    bool retired = size_ == depth_;
+    if (retired) {
+        retire(completed);
+    }
+    size_t slot = head_ + size_ < depth_ ? head_ + size_ : head_ + size_ - depth_;
+    probes_[slot] = filter_.beginLookupHash(hash_value);
+    tags_[slot] = tag;
+    size_++;
+    return retired;
+}
+
+
+template<typename filter_type>
+inline bool InterleavedLookup<filter_type>::flush(LookupCompletion *completed) {
+    if (size_ == 0) {
+        return false;
+    }
+    retire(completed);
+    return true;
+}
+
+
+template<typename filter_type>
+size_t InterleavedLookup<filter_type>::inFlight() const {
+    return size_;
+}
+
+
+template<typename filter_type>
+size_t InterleavedLookup<filter_type>::depth() const {
+    return depth_;
+}
+
+#endif
@@ -0,0 +1,780 @@
+#ifndef CUCKOOFILTER_MORTON_FILTER_H
+#define CUCKOOFILTER_MORTON_FILTER_H
+
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+#include "cuckoo_filter.hpp"
+#include "morton_table.hpp"
+
+
+/**
+ * Cuckoo filter on compressed Morton blocks, see MortonTable, with the API of CuckooFilter. Every lookup
+ * probes the primary bucket, and the secondary one only if the overflow bit of the primary bucket is set,
+ * so lookups of read-mostly filters mostly touch one cache line. Fingerprints are 8 bits wide.
+ *
+ * @tparam element_type Working element type
+ * @tparam hasher_type Functor mapping keys to 64-bit hash values, see KeyHash
+ * @tparam index_policy Mapping of hash values and fingerprints to logical buckets
+ *
+ * Compiled with -DCUCKOO_FILTER_STATS, every operation updates per-thread FilterStats counters,
+ * aggregated by StatsRegistry::instance().collect().
+ */
+template<typename element_type, typename hasher_type = TransparentKeyHash, typename index_policy = XorIndexPolicy>
+class MortonFilter {
+
+private:
+    // compressed blocks storing elements' fingerprints
+    MortonTable *table_;
+
+    // maps hash values and fingerprints to logical buckets
+    index_policy index_policy_;
+
+    // number of stored elements, maintained by every insertion and deletion
+    size_t element_count_;
+
+    // used for calculating hash values
+    HashFunction<hasher_type> *hash_function_;
+
+    // fingerprints whose kick chain failed
+    VictimStash stash_;
+
+    // decides whether kicking starts for a new element, may be empty
+    AdmissionHook admission_hook_;
+
+    // whether lookups prefetch the secondary bucket before probing the primary one
+    LookupMode lookup_mode_;
+
+    /**
+     * Number of logical buckets used for a requested table size, a multiple of MORTON_BUCKETS accepted
+     * by index_policy.
+     *
+     * @param max_table_size Maximum number of logical buckets
+     * @return Number of logical buckets
+     */
+    static size_t tableSize(uint32_t max_table_size);
+
+    /**
+     * Function for calculating fingerprint out of given hash value.
+     *
+     * @param hash_value Hash value
+     * @return Non-zero 8-bit fingerprint
+     */
+    inline uint32_t fingerprint(uint32_t hash_value) const;
+
+    /**
+     * Method for calculating primary index and fingerprint from element hash value.
+     *
+     * @param hash_value 64-bit hash value of the element
+     * @param fp Fingerprint pointer
+     * @param index Index pointer
+     */
+    inline void firstPass(uint64_t hash_value, uint32_t *fp, size_t *index) const;
+
+    /**
+     * @param index Previously calculated index
+     * @param fp Element fingerprint
+     * @return Secondary index calculated from fingerprint and previous index
+     */
+    inline size_t indexComplement(size_t index, uint32_t fp) const;
+
+    /**
+     * Looking up fingerprint fp with primary bucket i1, the secondary bucket is probed only if the
+     * overflow bit of i1 is set.
+     */
+    inline bool lookup(uint32_t fp, size_t i1) const;
+
+    /**
+     * Insertion of fingerprint fp whose primary bucket is index. Both candidate buckets are tried before
+     * kicking starts, the overflow bit of the primary bucket is set before the secondary one is used.
+     * Maximum tries are defined with KICKS_MAX_COUNT constant. If the kick chain fails, the last kicked
+     * fingerprint is stashed.
+     *
+     * @param fp Fingerprint for insertion
+     * @param index Primary bucket of the fingerprint
+     * @param admit True if admission hook is consulted before kicking
+     * @return Inserted, Stashed, or RejectedFull if admission hook rejected the fingerprint
+     */
+    InsertStatus insert(uint32_t fp, size_t index, bool admit);
+
+    /**
+     * Moving a stashed fingerprint back to the table after a slot in bucket index is freed.
+     *
+     * @param index Index of bucket with a freed slot
+     */
+    void drainStash(size_t index);
+
+public:
+
+    /**
+     * @param max_table_size Maximum number of logical buckets, rounded down by index_policy::tableSize and
+     *                       to a multiple of MORTON_BUCKETS. Every block of MORTON_BLOCK_BYTES bytes holds
+     *                       MORTON_BUCKETS buckets, so this is also the table size in bytes.
+     * @param stash_size Number of fingerprints that can be stashed after failed insertions,
+     *                   between 1 and STASH_MAX_SIZE
+     * @param seed Hash seed, random by default
+     */
+    MortonFilter(uint32_t max_table_size, size_t stash_size = STASH_DEFAULT_SIZE, uint64_t seed = randomSeed());
+
+    /**
+     * Destructor that is in charge of memory clean-up.
+     */
+    ~MortonFilter();
+
+    /**
+     * Prints every non-empty logical bucket with its fingerprints in hexadecimal format.
+     */
+    void print();
+
+    /**
+     * Inserting element into Morton Filter.
+     *
+     * @param element Element for insertion
+     * @return True if element is inserted or stashed, false if it is rejected
+     */
+    template<typename key_type = element_type>
+    bool insertElement(const key_type &element);
+
+    /**
+     * Inserting element into Morton Filter and reporting where it ended up.
+     *
+     * @param element Element for insertion
+     * @param skip_present If true, element whose fingerprint is already contained is not inserted again
+     * @return Outcome of the insertion
+     */
+    template<typename key_type = element_type>
+    InsertStatus tryInsertElement(const key_type &element, bool skip_present = false);
+
+    /**
+     * Inserting element only if its fingerprint is not contained yet.
+     *
+     * @param element Element for insertion
+     * @return AlreadyPresent if element was contained, otherwise outcome of the insertion
+     */
+    template<typename key_type = element_type>
+    InsertStatus insertIfAbsent(const key_type &element);
+
+    /**
+     * Setting hook which is consulted before kicking starts for a new element. Empty hook admits
+     * every element.
+     *
+     * @param hook Admission hook
+     */
+    void setAdmissionHook(AdmissionHook hook);
+
+    /**
+     * Setting how lookups reach the secondary bucket, Sequential by default. Speculative lookups prefetch
+     * the secondary block even if the overflow bit turns out to be clear.
+     *
+     * @param mode Lookup mode
+     */
+    void setLookupMode(LookupMode mode);
+
+    /**
+     * Retrieves lookup mode.
+     * @return lookup mode
+     */
+    LookupMode getLookupMode() const;
+
+    /**
+     * Retrieves current occupancy of the table and the stash.
+     * @return load snapshot
+     */
+    FilterLoad getLoad();
+
+    /**
+     * Deleting element from Morton Filter.
+     *
+     * @param element Element for deletion
+     * @return True if item is deleted
+     */
+    template<typename key_type = element_type>
+    bool deleteElement(const key_type &element);
+
+    /**
+     * Checking if element is contained in Morton Filter.
+     *
+     * @param element Element to check
+     * @return True if item is contained
+     */
+    template<typename key_type = element_type>
+    bool containsElement(const key_type &element) const;
+
+    /**
+     * Inserting element given by its precomputed 64-bit hash value, see CuckooFilter::insertHash.
+     *
+     * @param hash_value Hash value of the element
+     * @return True if element is inserted or stashed, false if it is rejected
+     */
+    bool insertHash(uint64_t hash_value);
+
+    /**
+     * Inserting element given by its precomputed hash value and reporting where it ended up.
+     *
+     * @param hash_value Hash value of the element
+     * @param skip_present If true, element whose fingerprint is already contained is not inserted again
+     * @return Outcome of the insertion
+     */
+    InsertStatus tryInsertHash(uint64_t hash_value, bool skip_present = false);
+
+    /**
+     * Deleting element given by its precomputed hash value.
+     *
+     * @param hash_value Hash value of the element
+     * @return True if item is deleted
+     */
+    bool deleteHash(uint64_t hash_value);
+
+    /**
+     * Checking if element given by its precomputed hash value is contained.
+     *
+     * @param hash_value Hash value of the element
+     * @return True if item is contained
+     */
+    bool containsHash(uint64_t hash_value) const;
+
+    /**
+     * Inserting n elements given by precomputed hash values. Primary blocks of BATCH_SIZE consecutive
+     * elements are prefetched before they are inserted.
+     *
+     * @param hash_values Hash values of the elements
+     * @param n Number of elements
+     * @return Number of inserted or stashed elements
+     */
+    size_t insertHashes(const uint64_t *hash_values, size_t n);
+
+    /**
+     * Deleting n elements given by precomputed hash values.
+     *
+     * @param hash_values Hash values of the elements
+     * @param n Number of elements
+     * @return Number of deleted elements
+     */
+    size_t deleteHashes(const uint64_t *hash_values, size_t n);
+
+    /**
+     * Checking n elements given by precomputed hash values. Primary blocks of BATCH_SIZE consecutive
+     * elements are prefetched before any of them is probed.
+     *
+     * @param hash_values Hash values of the elements
+     * @param n Number of elements
+     * @param results Array of size n, results[k] is set to true if k-th element is contained
+     * @return Number of contained elements
+     */
+    size_t containsHashes(const uint64_t *hash_values, size_t n, bool *results) const;
+
+    /**
+     * First phase of a lookup split in two, calculates both candidate buckets and prefetches the primary
+     * block, the secondary one is rarely needed.
+     *
+     * @param element Element to look up
+     * @return Probe to be finished by endLookup
+     */
+    template<typename key_type = element_type>
+    LookupProbe beginLookup(const key_type &element) const;
+
+    /**
+     * First phase of a lookup of element given by its precomputed hash value.
+     *
+     * @param hash_value Hash value of the element
+     * @return Probe to be finished by endLookup
+     */
+    LookupProbe beginLookupHash(uint64_t hash_value) const;
+
+    /**
+     * Second phase of a lookup, probes the block prefetched by beginLookup.
+     *
+     * @param probe Probe returned by beginLookup or beginLookupHash
+     * @return True if item is contained
+     */
+    bool endLookup(const LookupProbe &probe) const;
+
+    /**
+     * Calculates the percentage of free slots.
+     * @return percentage of free space in the filter's table
+     */
+    double availability();
+
+    /**
+     * Retrieves number of fingerprints stored in the table, stashed fingerprints are not included.
+     * @return element count
+     */
+    size_t getElementCount();
+
+    /**
+     * Retrieves ratio of occupied physical slots.
+     * @return load factor between 0 and 1
+     */
+    double getLoadFactor();
+
+    /**
+     * Counts occupied slots of all blocks and compares the result with the maintained element count.
+     * @return True if the maintained element count is correct
+     */
+    bool auditElementCount();
+
+    /**
+     * Retrieves total number of logical buckets in the table.
+     * @return table size
+     */
+    size_t getTableSize();
+
+    /**
+     * Retrieves size of the table in bytes.
+     * @return number of blocks times MORTON_BLOCK_BYTES
+     */
+    size_t getTableBytes();
+
+    /**
+     * Retrieves hash seed of the filter.
+     * @return hash seed
+     */
+    uint64_t getSeed();
+
+    /**
+     * Retrieves number of fingerprints currently kept in the stash.
+     * @return stash size
+     */
+    size_t getStashSize();
+};
+
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+size_t MortonFilter<element_type, hasher_type, index_policy>::tableSize(const uint32_t max_table_size) {
+    size_t table_size = index_policy::tableSize(max_table_size, MORTON_BUCKET_CAPACITY);
+    // index policies round to powers of two or to multiples of a power of two, both stay compatible
+    table_size = table_size / MORTON_BUCKETS * MORTON_BUCKETS;
+    if (table_size == 0) {
+        throw std::runtime_error("Table size must be at least " + std::to_string(MORTON_BUCKETS) + " buckets.\n");
+    }
+    return table_size;
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+MortonFilter<element_type, hasher_type, index_policy>::
+MortonFilter(uint32_t max_table_size, size_t stash_size, uint64_t seed)
+        : index_policy_(tableSize(max_table_size), MORTON_BUCKET_CAPACITY), stash_(stash_size) {
+    if (stash_size == 0 || stash_size > STASH_MAX_SIZE) {
+        throw std::runtime_error("Invalid stash size, supported values are 1 to " +
+                                 std::to_string(STASH_MAX_SIZE) + ".\n");
+    }
+    element_count_ = 0;
+    lookup_mode_ = LookupMode::Sequential;
+    table_ = new MortonTable(tableSize(max_table_size));
+    hash_function_ = new HashFunction<hasher_type>(seed);
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+MortonFilter<element_type, hasher_type, index_policy>::~MortonFilter() {
+    delete table_;
+    delete hash_function_;
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+uint32_t MortonFilter<element_type, hasher_type, index_policy>::fingerprint(const uint32_t hash_value) const {
+    uint32_t fingerprint = hash_value & 0xFF;
+    // stash marks free entries with 0
+    fingerprint += (fingerprint == 0);
+    return fingerprint;
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+void MortonFilter<element_type, hasher_type, index_policy>::
+firstPass(const uint64_t hash_value, uint32_t *fp, size_t *index) const {
+    *index = index_policy_.index(hash_value >> 32);
+    *fp = fingerprint(hash_value);
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+size_t MortonFilter<element_type, hasher_type, index_policy>::
+indexComplement(const size_t index, const uint32_t fp) const {
+    return index_policy_.alternate(index, fp);
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+bool MortonFilter<element_type, hasher_type, index_policy>::lookup(const uint32_t fp, const size_t i1) const {
+    if (table_->containsFingerprint(i1, fp)) {
+        CF_STATS(StatsRegistry::local().lookup_hits++; StatsRegistry::local().first_bucket_hits++);
+        return true;
+    }
+    bool overflowed = table_->overflowed(i1);
+    if (!overflowed && stash_.empty()) {
+        return false;
+    }
+
+    size_t i2 = indexComplement(i1, fp);
+    if (overflowed && table_->containsFingerprint(i2, fp)) {
+        CF_STATS(StatsRegistry::local().lookup_hits++);
+        return true;
+    }
+    if (!stash_.empty() && stash_.contains(fp, i1, i2)) {
+        CF_STATS(StatsRegistry::local().lookup_hits++; StatsRegistry::local().stash_hits++);
+        return true;
+    }
+    return false;
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+InsertStatus MortonFilter<element_type, hasher_type, index_policy>::
+insert(const uint32_t fp, const size_t index, const bool admit) {
+    if (table_->insertFingerprint(index, fp)) {
+        this->element_count_++;
+        CF_STATS(if (admit) StatsRegistry::local().recordKicks(0));
+        return InsertStatus::Inserted;
+    }
+
+    // the fingerprint leaves its primary bucket, lookups have to probe the secondary one
+    table_->markOverflow(index);
+    size_t curr_index = indexComplement(index, fp);
+    uint32_t curr_fp = fp;
+    if (table_->insertFingerprint(curr_index, curr_fp)) {
+        this->element_count_++;
+        CF_STATS(if (admit) StatsRegistry::local().recordKicks(0));
+        return InsertStatus::Inserted;
+    }
+    if (admit && admission_hook_ && !admission_hook_(getLoad())) {
+        CF_STATS(StatsRegistry::local().rejected++);
+        return InsertStatus::RejectedFull;
+    }
+
+    for (int kicks = 1; kicks <= KICKS_MAX_COUNT; kicks++) {
+        // evicting marks the overflow bit of the bucket the victim leaves
+        size_t victim_index;
+        curr_fp = table_->evictFingerprint(curr_index, curr_fp, victim_index);
+        curr_index = indexComplement(victim_index, curr_fp);
+        if (table_->insertFingerprint(curr_index, curr_fp)) {
+            this->element_count_++;
+            CF_STATS(if (admit) StatsRegistry::local().recordKicks(kicks));
+            return InsertStatus::Inserted;
+        }
+    }
+
+    stash_.push(curr_fp, curr_index);
+    CF_STATS(if (admit) StatsRegistry::local().stashed++);
+    CF_STATS(if (admit) StatsRegistry::local().recordKicks(KICKS_MAX_COUNT));
+    return InsertStatus::Stashed;
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+void MortonFilter<element_type, hasher_type, index_policy>::drainStash(const size_t index) {
+    Victim victim;
+
+    for (size_t k = 0; k < stash_.size(); k++) {
+        victim = stash_.get(k);
+        size_t alternate = indexComplement(victim.index, victim.fp);
+        if (victim.index == index || alternate == index) {
+            stash_.removeAt(k);
+            // which candidate is primary is not known, lookups must reach the fingerprint from both
+            table_->markOverflow(victim.index == index ? alternate : victim.index);
+            table_->insertFingerprint(index, victim.fp);
+            this->element_count_++;
+            CF_STATS(StatsRegistry::local().stash_drains++);
+            return;
+        }
+    }
+
+    victim = stash_.pop();
+    table_->markOverflow(victim.index);
+    table_->markOverflow(indexComplement(victim.index, victim.fp));
+    if (this->insert(victim.fp, victim.index, false) == InsertStatus::Inserted) {
+        CF_STATS(StatsRegistry::local().stash_drains++);
+    }
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+template<typename key_type>
+bool MortonFilter<element_type, hasher_type, index_policy>::insertElement(const key_type &element) {
+    return tryInsertElement(element) != InsertStatus::RejectedFull;
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+template<typename key_type>
+InsertStatus MortonFilter<element_type, hasher_type, index_policy>::
+tryInsertElement(const key_type &element, const bool skip_present) {
+    return tryInsertHash(hash_function_->hash(element), skip_present);
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+template<typename key_type>
+InsertStatus MortonFilter<element_type, hasher_type, index_policy>::insertIfAbsent(const key_type &element) {
+    return tryInsertHash(hash_function_->hash(element), true);
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+InsertStatus MortonFilter<element_type, hasher_type, index_policy>::
+tryInsertHash(const uint64_t hash_value, const bool skip_present) {
+    size_t index;
+    uint32_t fp;
+
+    CF_STATS(StatsRegistry::local().insertions++);
+
+    // a failed kick chain could not be stashed
+    if (stash_.full()) {
+        CF_STATS(StatsRegistry::local().rejected++);
+        return InsertStatus::RejectedFull;
+    }
+
+    firstPass(hash_value, &fp, &index);
+    // the primary block is loaded by the test and stays cached for the insertion
+    if (skip_present && lookup(fp, index)) {
+        return InsertStatus::AlreadyPresent;
+    }
+    return this->insert(fp, index, true);
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+void MortonFilter<element_type, hasher_type, index_policy>::setAdmissionHook(AdmissionHook hook) {
+    this->admission_hook_ = hook;
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+void MortonFilter<element_type, hasher_type, index_policy>::setLookupMode(const LookupMode mode) {
+    this->lookup_mode_ = mode;
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+LookupMode MortonFilter<element_type, hasher_type, index_policy>::getLookupMode() const {
+    return this->lookup_mode_;
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+FilterLoad MortonFilter<element_type, hasher_type, index_policy>::getLoad() {
+    FilterLoad load;
+    load.element_count = this->element_count_;
+    load.capacity = this->table_->maxNoOfElements();
+    load.stash_size = this->stash_.size();
+    load.stash_capacity = this->stash_.capacity();
+    load.load_factor = getLoadFactor();
+    return load;
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+template<typename key_type>
+bool MortonFilter<element_type, hasher_type, index_policy>::deleteElement(const key_type &element) {
+    return deleteHash(hash_function_->hash(element));
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+bool MortonFilter<element_type, hasher_type, index_policy>::deleteHash(const uint64_t hash_value) {
+    uint32_t fp;
+    size_t i1, i2;
+    size_t freed;
+
+    CF_STATS(StatsRegistry::local().deletions++);
+
+    firstPass(hash_value, &fp, &i1);
+    i2 = indexComplement(i1, fp);
+
+    if (table_->deleteFingerprint(fp, i1)) {
+        freed = i1;
+    } else if (table_->overflowed(i1) && table_->deleteFingerprint(fp, i2)) {
+        freed = i2;
+    } else {
+        // element count remains unmodified, stashed elements are not regarded as a part of the table
+        bool removed = !stash_.empty() && stash_.remove(fp, i1, i2);
+        CF_STATS(StatsRegistry::local().deletion_hits += removed);
+        return removed;
+    }
+    this->element_count_--;
+
+    CF_STATS(StatsRegistry::local().deletion_hits++);
+
+    if (!stash_.empty()) {
+        drainStash(freed);
+    }
+
+    return true;
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+template<typename key_type>
+bool MortonFilter<element_type, hasher_type, index_policy>::containsElement(const key_type &element) const {
+    return containsHash(hash_function_->hash(element));
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+bool MortonFilter<element_type, hasher_type, index_policy>::containsHash(const uint64_t hash_value) const {
+    uint32_t fp;
+    size_t i1;
+
+    CF_STATS(StatsRegistry::local().lookups++);
+
+    firstPass(hash_value, &fp, &i1);
+    if (lookup_mode_ == LookupMode::Speculative) {
+        table_->prefetchBucket(indexComplement(i1, fp), false);
+    }
+    return lookup(fp, i1);
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+bool MortonFilter<element_type, hasher_type, index_policy>::insertHash(const uint64_t hash_value) {
+    return tryInsertHash(hash_value) != InsertStatus::RejectedFull;
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+size_t MortonFilter<element_type, hasher_type, index_policy>::
+insertHashes(const uint64_t *hash_values, const size_t n) {
+    size_t inserted = 0;
+    uint32_t fp;
+    size_t index;
+
+    for (size_t start = 0; start < n; start += BATCH_SIZE) {
+        size_t end = std::min(n, start + BATCH_SIZE);
+        for (size_t k = start; k < end; k++) {
+            firstPass(hash_values[k], &fp, &index);
+            table_->prefetchBucket(index, true);
+        }
+        for (size_t k = start; k < end; k++) {
+            inserted += insertHash(hash_values[k]);
+        }
+    }
+    return inserted;
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+size_t MortonFilter<element_type, hasher_type, index_policy>::
+deleteHashes(const uint64_t *hash_values, const size_t n) {
+    size_t deleted = 0;
+    uint32_t fp;
+    size_t index;
+
+    for (size_t start = 0; start < n; start += BATCH_SIZE) {
+        size_t end = std::min(n, start + BATCH_SIZE);
+        for (size_t k = start; k < end; k++) {
+            firstPass(hash_values[k], &fp, &index);
+            table_->prefetchBucket(index, true);
+        }
+        for (size_t k = start; k < end; k++) {
+            deleted += deleteHash(hash_values[k]);
+        }
+    }
+    return deleted;
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+size_t MortonFilter<element_type, hasher_type, index_policy>::
+containsHashes(const uint64_t *hash_values, const size_t n, bool *results) const {
+    size_t contained = 0;
+    LookupProbe probes[BATCH_SIZE];
+
+    for (size_t start = 0; start < n; start += BATCH_SIZE) {
+        size_t count = std::min(n - start, (size_t) BATCH_SIZE);
+        for (size_t k = 0; k < count; k++) {
+            probes[k] = beginLookupHash(hash_values[start + k]);
+        }
+        for (size_t k = 0; k < count; k++) {
+            bool found = endLookup(probes[k]);
+            results[start + k] = found;
+            contained += found;
+        }
+    }
+    return contained;
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+template<typename key_type>
+LookupProbe MortonFilter<element_type, hasher_type, index_policy>::beginLookup(const key_type &element) const {
+    return beginLookupHash(hash_function_->hash(element));
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+LookupProbe MortonFilter<element_type, hasher_type, index_policy>::beginLookupHash(const uint64_t hash_value) const {
+    LookupProbe probe;
+    firstPass(hash_value, &probe.fp, &probe.i1);
+    probe.i2 = indexComplement(probe.i1, probe.fp);
+    table_->prefetchBucket(probe.i1, false);
+    return probe;
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+bool MortonFilter<element_type, hasher_type, index_policy>::endLookup(const LookupProbe &probe) const {
+    CF_STATS(StatsRegistry::local().lookups++);
+    return lookup(probe.fp, probe.i1);
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+void MortonFilter<element_type, hasher_type, index_policy>::print() {
+    table_->printTable();
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+double MortonFilter<element_type, hasher_type, index_policy>::availability() {
+    size_t ts = this->table_->maxNoOfElements();
+    size_t free = ts - this->element_count_;
+    return (free / ((double) ts)) * 100.;
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+size_t MortonFilter<element_type, hasher_type, index_policy>::getElementCount() {
+    return this->element_count_;
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+double MortonFilter<element_type, hasher_type, index_policy>::getLoadFactor() {
+    return this->element_count_ / ((double) this->table_->maxNoOfElements());
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+bool MortonFilter<element_type, hasher_type, index_policy>::auditElementCount() {
+    size_t occupied = this->table_->maxNoOfElements() - this->table_->getNumOfFreeEntries();
+    return occupied == this->element_count_;
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+size_t MortonFilter<element_type, hasher_type, index_policy>::getTableSize() {
+    return this->table_->getTableSize();
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+size_t MortonFilter<element_type, hasher_type, index_policy>::getTableBytes() {
+    return this->table_->getBlockCount() * MORTON_BLOCK_BYTES;
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+uint64_t MortonFilter<element_type, hasher_type, index_policy>::getSeed() {
+    return this->hash_function_->getSeed();
+}
+
+
+template<typename element_type, typename hasher_type, typename index_policy>
+size_t MortonFilter<element_type, hasher_type, index_policy>::getStashSize() {
+    return this->stash_.size();
+}
+
+#endif
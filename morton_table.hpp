@@ -0,0 +1,409 @@
+#ifndef CUCKOOFILTER_MORTON_TABLE_H
+#define CUCKOOFILTER_MORTON_TABLE_H
+
+#include <iostream>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+
+// size of a block, one cache line
+#define MORTON_BLOCK_BYTES 64
+// number of 8-bit fingerprints physically stored in a block
+#define MORTON_SLOTS 46
+// number of logical buckets sharing the slots of a block
+#define MORTON_BUCKETS 64
+// maximum number of fingerprints in a logical bucket, limited by the 2-bit fullness counters
+#define MORTON_BUCKET_CAPACITY 3
+// number of overflow tracking bits per block, logical buckets share them modulo this number
+#define MORTON_OTA_BITS 16
+
+
+/**
+ * Compressed bucket storage of Morton filters (Breslow and Jayasena, "Morton Filters: Faster, Space-Efficient
+ * Cuckoo Filters via Biasing, Compression, and Decoupled Logical Sparsity"). Logical buckets hold up to
+ * MORTON_BUCKET_CAPACITY 8-bit fingerprints, but most of them are almost empty, so MORTON_BUCKETS of them
+ * share MORTON_SLOTS physical slots of one cache-line block:
+ *
+ *  - fingerprint storage array: fingerprints of bucket j follow those of buckets 0 to j-1 without gaps,
+ *  - fullness counter array: 2-bit number of fingerprints of every bucket, the offset of bucket j is the sum
+ *    of the counters below it,
+ *  - overflow tracking array: bit j % MORTON_OTA_BITS is set once a fingerprint of bucket j has been placed
+ *    in or moved to its other candidate bucket. Lookups whose primary bucket has a clear bit end in the
+ *    primary block, so most negative lookups touch a single cache line.
+ *
+ * Overflow bits are never cleared, deleting a fingerprint only makes some later lookups probe a second block.
+ * Buckets are numbered globally, bucket i lives in block i / MORTON_BUCKETS.
+ */
+class MortonTable {
+
+private:
+    struct alignas(MORTON_BLOCK_BYTES) Block {
+        // fingerprint storage array
+        uint8_t fsa[MORTON_SLOTS];
+        // overflow tracking array
+        uint16_t ota;
+        // fullness counter array, counter of bucket j occupies bits 2 * (j % 32) of word j / 32
+        uint64_t fca[MORTON_BUCKETS / 32];
+    };
+
+    static_assert(sizeof(Block) == MORTON_BLOCK_BYTES, "Morton block must fill exactly one cache line");
+    // bucket lookups read 4 bytes from any offset up to MORTON_SLOTS, past fsa into ota and fca
+    static_assert(offsetof(Block, fsa) + MORTON_SLOTS + 4 <= MORTON_BLOCK_BYTES,
+                  "4-byte bucket reads must stay inside the block");
+
+    // number of logical buckets
+    size_t table_size;
+
+    // element storage
+    Block *blocks;
+
+    /**
+     * Sum of the 2-bit counters packed in word.
+     */
+    inline static size_t counterSum(uint64_t word);
+
+    /**
+     * Number of fingerprints in bucket j of block.
+     */
+    inline static size_t bucketCount(const Block &block, size_t j);
+
+    /**
+     * Slot of the first fingerprint of bucket j of block.
+     */
+    inline static size_t bucketOffset(const Block &block, size_t j);
+
+    /**
+     * Number of fingerprints stored in block.
+     */
+    inline static size_t blockCount(const Block &block);
+
+    /**
+     * Bucket of block which slot pos belongs to, pos must be below blockCount(block).
+     */
+    static size_t bucketAt(const Block &block, size_t pos);
+
+    /**
+     * Removing fingerprint in slot pos of bucket j, following fingerprints move one slot down.
+     */
+    inline static void removeSlot(Block &block, size_t j, size_t pos);
+
+public:
+
+    /**
+     * @param table_size Table size, total number of logical buckets, a positive multiple of MORTON_BUCKETS
+     */
+    explicit MortonTable(size_t table_size);
+
+    /**
+     * Deleting all blocks.
+     */
+    ~MortonTable();
+
+    /**
+     * Returning table size, number of logical buckets
+     *
+     * @return number of buckets
+     */
+    size_t getTableSize();
+
+    /**
+     * @return Number of blocks
+     */
+    size_t getBlockCount();
+
+    /**
+     * Returning maximum number of elements stored in table, the number of physical slots.
+     *
+     * @return Maximum possible number of elements
+     */
+    size_t maxNoOfElements();
+
+    /**
+     * Count of stored fingerprints in bucket.
+     *
+     * @param i Bucket index
+     * @return Number of fingerprints stored in one bucket
+     */
+    size_t fingerprintCount(size_t i);
+
+    /**
+     * Gets number of free slots of all blocks.
+     *
+     * @return Number of free slots
+     */
+    size_t getNumOfFreeEntries();
+
+    /**
+     * Prints every non-empty bucket with its fingerprints in hexadecimal format.
+     */
+    void printTable();
+
+    /**
+     * Storing fingerprint in bucket i if the bucket and its block have a free slot.
+     *
+     * @param i Bucket index
+     * @param fp Fingerprint for storing
+     * @return True if fingerprint is stored
+     */
+    bool insertFingerprint(size_t i, uint32_t fp);
+
+    /**
+     * Storing fingerprint in bucket i whose bucket or block is full by evicting a random fingerprint,
+     * from bucket i if it is full, otherwise from any bucket of the block. The overflow bit of the bucket
+     * the victim came from is set, as the victim is going to its other candidate bucket.
+     *
+     * @param i Bucket index
+     * @param fp Fingerprint for storing
+     * @param victim_index Set to index of bucket the victim was evicted from
+     * @return Evicted fingerprint
+     */
+    uint32_t evictFingerprint(size_t i, uint32_t fp, size_t &victim_index);
+
+    /**
+     * Checking if bucket i contains fingerprint fp
+     *
+     * @param i Bucket index
+     * @param fp Fingerprint for checking
+     * @return  True if fingerprint is contained
+     */
+    bool containsFingerprint(size_t i, uint32_t fp) const;
+
+    /**
+     * Deleting fingerprint from bucket i.
+     *
+     * @param fp  Fingerprint for deletion
+     * @param i Index of bucket where fingerprint is stored.
+     * @return True if element is deleted
+     */
+    bool deleteFingerprint(uint32_t fp, size_t i);
+
+    /**
+     * Checking overflow bit of bucket i.
+     *
+     * @param i Bucket index
+     * @return False if no fingerprint of bucket i can be in its other candidate bucket
+     */
+    bool overflowed(size_t i) const;
+
+    /**
+     * Setting overflow bit of bucket i, before a fingerprint of it is stored in its other candidate bucket.
+     *
+     * @param i Bucket index
+     */
+    void markOverflow(size_t i);
+
+    /**
+     * Hinting the processor to load the block of bucket i into cache ahead of its use.
+     *
+     * @param i Bucket index
+     * @param write True if bucket is going to be modified
+     */
+    void prefetchBucket(size_t i, bool write) const;
+};
+
+
+inline MortonTable::MortonTable(const size_t table_size) {
+    if (table_size == 0 || table_size % MORTON_BUCKETS != 0) {
+        throw std::runtime_error("Morton table size must be a positive multiple of " +
+                                 std::to_string(MORTON_BUCKETS) + " buckets.\n");
+    }
+    this->table_size = table_size;
+    blocks = new Block[table_size / MORTON_BUCKETS];
+    memset(blocks, 0, sizeof(Block) * (table_size / MORTON_BUCKETS));
+}
+
+
+inline MortonTable::~MortonTable() {
+    delete[] blocks;
+}
+
+
+inline size_t MortonTable::getTableSize() {
+    return table_size;
+}
+
+
+inline size_t MortonTable::getBlockCount() {
+    return table_size / MORTON_BUCKETS;
+}
+
+
+inline size_t MortonTable::maxNoOfElements() {
+    return getBlockCount() * MORTON_SLOTS;
+}
+
+
+inline size_t MortonTable::counterSum(const uint64_t word) {
+    // adding neighbouring fields, as the last steps of a bit count, needs no popcount instruction
+    uint64_t nibbles = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+    uint64_t bytes = (nibbles + (nibbles >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (bytes * 0x0101010101010101ULL) >> 56;
+}
+
+
+inline size_t MortonTable::bucketCount(const Block &block, const size_t j) {
+    return (block.fca[j / 32] >> ((j % 32) * 2)) & 3;
+}
+
+
+inline size_t MortonTable::bucketOffset(const Block &block, const size_t j) {
+    // counters below bucket j as a 128-bit mask, selected without branches since j is random
+    const size_t shift = 2 * j;
+    uint64_t low = shift >= 64 ? ~0ULL : (1ULL << shift) - 1;
+    uint64_t high = shift >= 64 ? (1ULL << (shift - 64)) - 1 : 0;
+    return counterSum(block.fca[0] & low) + counterSum(block.fca[1] & high);
+}
+
+
+inline size_t MortonTable::blockCount(const Block &block) {
+    return counterSum(block.fca[0]) + counterSum(block.fca[1]);
+}
+
+
+inline size_t MortonTable::bucketAt(const Block &block, const size_t pos) {
+    size_t end = 0;
+    for (size_t j = 0; j < MORTON_BUCKETS; j++) {
+        end += bucketCount(block, j);
+        if (pos < end) {
+            return j;
+        }
+    }
+    return MORTON_BUCKETS - 1;
+}
+
+
+inline void MortonTable::removeSlot(Block &block, const size_t j, const size_t pos) {
+    size_t count = blockCount(block);
+    memmove(block.fsa + pos, block.fsa + pos + 1, count - pos - 1);
+    block.fsa[count - 1] = 0;
+    block.fca[j / 32] -= 1ULL << ((j % 32) * 2);
+}
+
+
+inline size_t MortonTable::fingerprintCount(const size_t i) {
+    return bucketCount(blocks[i / MORTON_BUCKETS], i % MORTON_BUCKETS);
+}
+
+
+inline size_t MortonTable::getNumOfFreeEntries() {
+    size_t free = 0;
+    for (size_t b = 0; b < getBlockCount(); b++) {
+        free += MORTON_SLOTS - blockCount(blocks[b]);
+    }
+    return free;
+}
+
+
+inline void MortonTable::printTable() {
+    for (size_t i = 0; i < table_size; ++i) {
+        const Block &block = blocks[i / MORTON_BUCKETS];
+        size_t j = i % MORTON_BUCKETS;
+        size_t count = bucketCount(block, j);
+        if (count == 0) {
+            continue;
+        }
+        size_t offset = bucketOffset(block, j);
+        std::cout << i << " | ";
+        for (size_t k = 0; k < count; ++k) {
+            std::cout << std::setfill('0') << std::setw(2) << std::hex << (uint32_t) block.fsa[offset + k] << " ";
+        }
+        std::cout << std::dec << std::endl;
+    }
+}
+
+
+inline bool MortonTable::insertFingerprint(const size_t i, const uint32_t fp) {
+    Block &block = blocks[i / MORTON_BUCKETS];
+    const size_t j = i % MORTON_BUCKETS;
+    const size_t count = bucketCount(block, j);
+    const size_t total = blockCount(block);
+    if (count == MORTON_BUCKET_CAPACITY || total == MORTON_SLOTS) {
+        return false;
+    }
+    // fingerprints of the following buckets move one slot up
+    size_t pos = bucketOffset(block, j) + count;
+    memmove(block.fsa + pos + 1, block.fsa + pos, total - pos);
+    block.fsa[pos] = (uint8_t) fp;
+    block.fca[j / 32] += 1ULL << ((j % 32) * 2);
+    return true;
+}
+
+
+inline uint32_t MortonTable::evictFingerprint(const size_t i, const uint32_t fp, size_t &victim_index) {
+    Block &block = blocks[i / MORTON_BUCKETS];
+    const size_t j = i % MORTON_BUCKETS;
+    size_t victim_j, pos;
+
+    if (bucketCount(block, j) == MORTON_BUCKET_CAPACITY) {
+        victim_j = j;
+        pos = bucketOffset(block, j) + rand() % MORTON_BUCKET_CAPACITY;
+    } else {
+        // block is full, a fingerprint of any bucket makes room
+        pos = rand() % MORTON_SLOTS;
+        victim_j = bucketAt(block, pos);
+    }
+
+    uint32_t victim = block.fsa[pos];
+    removeSlot(block, victim_j, pos);
+    block.ota |= 1U << (victim_j % MORTON_OTA_BITS);
+    insertFingerprint(i, fp);
+
+    victim_index = i - j + victim_j;
+    return victim;
+}
+
+
+inline bool MortonTable::containsFingerprint(const size_t i, const uint32_t fp) const {
+    const Block &block = blocks[i / MORTON_BUCKETS];
+    const size_t j = i % MORTON_BUCKETS;
+    const size_t count = bucketCount(block, j);
+    // an empty trailing bucket of a full block starts at slot 46, the 4 bytes read then cover ota and stay
+    // inside the block, bytes beyond count are masked off below
+    uint32_t word;
+    memcpy(&word, block.fsa + bucketOffset(block, j), sizeof(word));
+    // zero bytes of x mark matches, a spurious mark only follows a real one
+    uint32_t x = word ^ (fp * 0x01010101U);
+    uint32_t zero = (x - 0x01010101U) & ~x & 0x80808080U;
+    return zero & ((1U << (count * 8)) - 1);
+}
+
+
+inline bool MortonTable::deleteFingerprint(const uint32_t fp, const size_t i) {
+    Block &block = blocks[i / MORTON_BUCKETS];
+    const size_t j = i % MORTON_BUCKETS;
+    const size_t count = bucketCount(block, j);
+    const size_t offset = bucketOffset(block, j);
+    for (size_t k = 0; k < count; k++) {
+        if (block.fsa[offset + k] == fp) {
+            removeSlot(block, j, offset + k);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+inline bool MortonTable::overflowed(const size_t i) const {
+    return (blocks[i / MORTON_BUCKETS].ota >> (i % MORTON_BUCKETS % MORTON_OTA_BITS)) & 1;
+}
+
+
+inline void MortonTable::markOverflow(const size_t i) {
+    blocks[i / MORTON_BUCKETS].ota |= 1U << (i % MORTON_BUCKETS % MORTON_OTA_BITS);
+}
+
+
+inline void MortonTable::prefetchBucket(const size_t i, const bool write) const {
+    const Block *block = blocks + i / MORTON_BUCKETS;
+    if (write) {
+        __builtin_prefetch(block, 1);
+    } else {
+        __builtin_prefetch(block, 0);
+    }
+}
+
+#endif
@@ -0,0 +1,537 @@
+#ifndef CUCKOOFILTER_PAYLOAD_FILTER_H
+#define CUCKOOFILTER_PAYLOAD_FILTER_H
+
+#include <stdexcept>
+#include <string>
+#include "cuckoo_filter.hpp"
+
+
+/**
+ * Layout of a table entry holding a fingerprint in its lower bits and a small value above it. Entries are
+ * stored and matched by the BitManager of the whole entry width, lookups compare only the fingerprint bits
+ * with BitManager::matchMask(value, fp, fp_mask).
+ *
+ * @tparam bits_per_slot Number of bits of a table entry
+ * @tparam value_bits Number of value bits of an entry, 1 to 8
+ */
+template<size_t bits_per_slot, size_t value_bits>
+class PayloadCodec {
+
+    static_assert(value_bits >= 1 && value_bits <= 8, "Payloads of 1 to 8 bits are supported");
+    static_assert(bits_per_slot >= value_bits + 4, "At least 4 fingerprint bits must remain in an entry");
+
+public:
+    static const size_t fp_bits = bits_per_slot - value_bits;
+    static const uint32_t fp_mask = (1ULL << fp_bits) - 1;
+    static const uint32_t value_mask = (1U << value_bits) - 1;
+    static const uint32_t slot_mask = (1ULL << bits_per_slot) - 1;
+
+    /**
+     * @param fp Non-zero fingerprint of fp_bits bits
+     * @param value Value of value_bits bits
+     * @return Table entry
+     */
+    inline static uint32_t encode(uint32_t fp, uint32_t value) {
+        return fp | (value << fp_bits);
+    }
+
+    /**
+     * @param entry Table entry
+     * @return Fingerprint of entry
+     */
+    inline static uint32_t fingerprint(uint32_t entry) {
+        return entry & fp_mask;
+    }
+
+    /**
+     * @param entry Table entry
+     * @return Value of entry
+     */
+    inline static uint32_t value(uint32_t entry) {
+        return (entry >> fp_bits) & value_mask;
+    }
+};
+
+
+/**
+ * Cuckoo filter storing a value of value_bits bits with every fingerprint, e.g. the shard, tier or version
+ * an element belongs to, so one lookup both tests membership and tells where the element lives. Entries
+ * have the layouts of CuckooFilter, (entries_per_bucket, bits_per_slot, slot_type) must be one of the
+ * supported CuckooTable parameters, and value_bits of each entry are taken from the fingerprint. Buckets
+ * are chosen by the fingerprint alone, so an entry keeps its candidate buckets whatever its value is.
+ *
+ * Elements whose fingerprints collide share false positives as in CuckooFilter, and lookupValue may then
+ * return the value of the colliding element. Entries are therefore deleted and updated by their exact
+ * (fingerprint, value) pair, which never removes the entry of another element.
+ *
+ * @tparam element_type Working element type
+ * @tparam entries_per_bucket Number of entries in bucket
+ * @tparam bits_per_slot Number of bits of an entry, fingerprint and value together
+ * @tparam slot_type Entry type of the table
+ * @tparam value_bits Number of value bits of an entry, 1 to 8
+ * @tparam hasher_type Functor mapping keys to 64-bit hash values, see KeyHash
+ * @tparam index_policy Mapping of hash values and fingerprints to buckets
+ *
+ * Compiled with -DCUCKOO_FILTER_STATS, every operation updates per-thread FilterStats counters,
+ * aggregated by StatsRegistry::instance().collect().
+ */
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type = TransparentKeyHash, typename index_policy = XorIndexPolicy>
+class PayloadFilter {
+
+public:
+    typedef PayloadCodec<bits_per_slot, value_bits> codec;
+
+private:
+    // table storing encoded entries, its fingerprint mask covers the whole entry
+    CuckooTable<entries_per_bucket, bits_per_slot, slot_type> *table_;
+
+    // maps hash values and fingerprints to buckets
+    index_policy index_policy_;
+
+    // number of stored elements, maintained by every insertion and deletion
+    size_t element_count_;
+
+    // used for calculating hash values
+    HashFunction<hasher_type> *hash_function_;
+
+    // encoded entries whose kick chain failed
+    VictimStash stash_;
+
+    /**
+     * Method for calculating primary index and fingerprint from element hash value.
+     *
+     * @param hash_value 64-bit hash value of the element
+     * @param fp Fingerprint pointer
+     * @param index Index pointer
+     */
+    inline void firstPass(uint64_t hash_value, uint32_t *fp, size_t *index) const;
+
+    /**
+     * Checking value fits into value_bits bits.
+     */
+    inline static void checkValue(uint32_t value);
+
+    /**
+     * Position of a stashed entry with fingerprint fp and candidate buckets i1 and i2, or stash size if
+     * there is none.
+     */
+    size_t findStashed(uint32_t fp, size_t i1, size_t i2) const;
+
+    /**
+     * @return Kick chain over the table and stash of this filter, kicking encoded entries whole
+     */
+    inline KickChain<CuckooTable<entries_per_bucket, bits_per_slot, slot_type>, index_policy, codec> chain();
+
+public:
+
+    /**
+     * @param max_table_size Maximum number of buckets, number of buckets is chosen by index_policy::tableSize
+     * @param stash_size Number of entries that can be stashed after failed insertions,
+     *                   between 1 and STASH_MAX_SIZE
+     * @param seed Hash seed, random by default
+     */
+    PayloadFilter(uint32_t max_table_size, size_t stash_size = STASH_DEFAULT_SIZE, uint64_t seed = randomSeed());
+
+    /**
+     * Destructor that is in charge of memory clean-up.
+     */
+    ~PayloadFilter();
+
+    /**
+     * Inserting element with value. An element inserted twice is stored twice, see updateValue.
+     *
+     * @param element Element for insertion
+     * @param value Value of value_bits bits
+     * @return True if element is inserted or stashed, false if it is rejected
+     */
+    template<typename key_type = element_type>
+    bool insertElement(const key_type &element, uint32_t value);
+
+    /**
+     * Inserting element with value and reporting where it ended up.
+     *
+     * @param element Element for insertion
+     * @param value Value of value_bits bits
+     * @return Inserted, Stashed, or RejectedFull if the stash is full
+     */
+    template<typename key_type = element_type>
+    InsertStatus tryInsertElement(const key_type &element, uint32_t value);
+
+    /**
+     * Inserting element given by its precomputed 64-bit hash value, see CuckooFilter::insertHash.
+     *
+     * @param hash_value Hash value of the element
+     * @param value Value of value_bits bits
+     * @return Inserted, Stashed, or RejectedFull if the stash is full
+     */
+    InsertStatus tryInsertHash(uint64_t hash_value, uint32_t value);
+
+    /**
+     * Looking up value stored with element.
+     *
+     * @param element Element to look up
+     * @param value Set to value of the first entry matching the element's fingerprint
+     * @return True if item is contained
+     */
+    template<typename key_type = element_type>
+    bool lookupValue(const key_type &element, uint32_t &value) const;
+
+    /**
+     * Looking up value stored with element given by its precomputed hash value.
+     *
+     * @param hash_value Hash value of the element
+     * @param value Set to value of the first entry matching the element's fingerprint
+     * @return True if item is contained
+     */
+    bool lookupHash(uint64_t hash_value, uint32_t &value) const;
+
+    /**
+     * Checking if element is contained, whatever its value is.
+     *
+     * @param element Element to check
+     * @return True if item is contained
+     */
+    template<typename key_type = element_type>
+    bool containsElement(const key_type &element) const;
+
+    /**
+     * Replacing value of element's entry in place, e.g. after the element moved to another tier.
+     *
+     * @param element Element to update
+     * @param old_value Value the element was inserted or last updated with
+     * @param new_value New value of value_bits bits
+     * @return True if an entry with old_value was found and updated
+     */
+    template<typename key_type = element_type>
+    bool updateValue(const key_type &element, uint32_t old_value, uint32_t new_value);
+
+    /**
+     * Deleting element's entry with value.
+     *
+     * @param element Element for deletion
+     * @param value Value the element was inserted or last updated with
+     * @return True if item is deleted
+     */
+    template<typename key_type = element_type>
+    bool deleteElement(const key_type &element, uint32_t value);
+
+    /**
+     * Deleting element given by its precomputed hash value.
+     *
+     * @param hash_value Hash value of the element
+     * @param value Value the element was inserted or last updated with
+     * @return True if item is deleted
+     */
+    bool deleteHash(uint64_t hash_value, uint32_t value);
+
+    /**
+     * Retrieves number of entries stored in the table, stashed entries are not included.
+     * @return element count
+     */
+    size_t getElementCount();
+
+    /**
+     * Retrieves ratio of occupied entries.
+     * @return load factor between 0 and 1
+     */
+    double getLoadFactor();
+
+    /**
+     * Retrieves total number of buckets in the table.
+     * @return table size
+     */
+    size_t getTableSize();
+
+    /**
+     * Retrieves size of the table in bytes.
+     * @return table size in bytes
+     */
+    size_t getTableBytes();
+
+    /**
+     * Retrieves hash seed of the filter.
+     * @return hash seed
+     */
+    uint64_t getSeed();
+
+    /**
+     * Retrieves number of entries currently kept in the stash.
+     * @return stash size
+     */
+    size_t getStashSize();
+};
+
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+PayloadFilter(uint32_t max_table_size, size_t stash_size, uint64_t seed)
+        : index_policy_(index_policy::tableSize(max_table_size, entries_per_bucket), entries_per_bucket),
+          stash_(stash_size) {
+    if (stash_size == 0 || stash_size > STASH_MAX_SIZE) {
+        throw std::runtime_error("Invalid stash size, supported values are 1 to " +
+                                 std::to_string(STASH_MAX_SIZE) + ".\n");
+    }
+    if (max_table_size == 0) {
+        throw std::runtime_error("Table size must be positive.\n");
+    }
+    element_count_ = 0;
+    size_t table_size = index_policy::tableSize(max_table_size, entries_per_bucket);
+
+    table_ = new CuckooTable<entries_per_bucket, bits_per_slot, slot_type>(table_size, codec::slot_mask);
+    hash_function_ = new HashFunction<hasher_type>(seed);
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+~PayloadFilter() {
+    delete table_;
+    delete hash_function_;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+void PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+firstPass(const uint64_t hash_value, uint32_t *fp, size_t *index) const {
+    *index = index_policy_.index(hash_value >> 32);
+    *fp = hash_value & codec::fp_mask;
+    // make sure that fingerprint != 0, free entries are 0
+    *fp += (*fp == 0);
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+void PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+checkValue(const uint32_t value) {
+    if (value > codec::value_mask) {
+        throw std::runtime_error("Value does not fit into " + std::to_string(value_bits) + " bits.\n");
+    }
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+size_t
+PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+findStashed(const uint32_t fp, const size_t i1, const size_t i2) const {
+    for (size_t k = 0; k < stash_.size(); k++) {
+        Victim victim = stash_.get(k);
+        if (codec::fingerprint(victim.fp) == fp && (victim.index == i1 || victim.index == i2)) {
+            return k;
+        }
+    }
+    return stash_.size();
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+KickChain<CuckooTable<entries_per_bucket, bits_per_slot, slot_type>, index_policy,
+          PayloadCodec<bits_per_slot, value_bits>>
+PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+chain() {
+    return {*table_, index_policy_, stash_, element_count_};
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+template<typename key_type>
+bool PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+insertElement(const key_type &element, const uint32_t value) {
+    return tryInsertElement(element, value) != InsertStatus::RejectedFull;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+template<typename key_type>
+InsertStatus
+PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+tryInsertElement(const key_type &element, const uint32_t value) {
+    return tryInsertHash(hash_function_->hash(element), value);
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+InsertStatus
+PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+tryInsertHash(const uint64_t hash_value, const uint32_t value) {
+    size_t index;
+    uint32_t fp;
+
+    checkValue(value);
+    CF_STATS(StatsRegistry::local().insertions++);
+
+    // a failed kick chain could not be stashed
+    if (stash_.full()) {
+        CF_STATS(StatsRegistry::local().rejected++);
+        return InsertStatus::RejectedFull;
+    }
+
+    firstPass(hash_value, &fp, &index);
+    return chain().insert(codec::encode(fp, value), index, true, [](int, size_t) { return true; });
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+template<typename key_type>
+bool PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+lookupValue(const key_type &element, uint32_t &value) const {
+    return lookupHash(hash_function_->hash(element), value);
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+bool PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+lookupHash(const uint64_t hash_value, uint32_t &value) const {
+    uint32_t fp;
+    size_t i1, i2, holder;
+    uint32_t entry;
+
+    CF_STATS(StatsRegistry::local().lookups++);
+
+    firstPass(hash_value, &fp, &i1);
+    i2 = index_policy_.alternate(i1, fp);
+    if (table_->findEntry(i1, i2, fp, codec::fp_mask, entry, holder)) {
+        CF_STATS(StatsRegistry::local().lookup_hits++; StatsRegistry::local().first_bucket_hits += holder == i1);
+        value = codec::value(entry);
+        return true;
+    }
+    if (!stash_.empty()) {
+        size_t k = findStashed(fp, i1, i2);
+        if (k != stash_.size()) {
+            CF_STATS(StatsRegistry::local().lookup_hits++; StatsRegistry::local().stash_hits++);
+            value = codec::value(stash_.get(k).fp);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+template<typename key_type>
+bool PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+containsElement(const key_type &element) const {
+    uint32_t value;
+    return lookupHash(hash_function_->hash(element), value);
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+template<typename key_type>
+bool PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+updateValue(const key_type &element, const uint32_t old_value, const uint32_t new_value) {
+    uint32_t fp;
+    size_t i1, i2;
+    size_t freed;
+    uint32_t prev_entry;
+
+    checkValue(old_value);
+    checkValue(new_value);
+    firstPass(hash_function_->hash(element), &fp, &i1);
+    i2 = index_policy_.alternate(i1, fp);
+
+    // the bucket keeps its slot count, so the new entry fits where the old one was
+    if (table_->deleteFingerprint(codec::encode(fp, old_value), i1, i2, freed)) {
+        table_->replacingFingerprintInsertion(freed, codec::encode(fp, new_value), false, prev_entry);
+        return true;
+    }
+    if (!stash_.empty() && stash_.remove(codec::encode(fp, old_value), i1, i2)) {
+        stash_.push(codec::encode(fp, new_value), i1);
+        return true;
+    }
+    return false;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+template<typename key_type>
+bool PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+deleteElement(const key_type &element, const uint32_t value) {
+    return deleteHash(hash_function_->hash(element), value);
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+bool PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+deleteHash(const uint64_t hash_value, const uint32_t value) {
+    uint32_t fp;
+    size_t i1;
+
+    checkValue(value);
+    CF_STATS(StatsRegistry::local().deletions++);
+
+    firstPass(hash_value, &fp, &i1);
+    return chain().remove(codec::encode(fp, value), i1, index_policy_.alternate(i1, fp));
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+size_t
+PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+getElementCount() {
+    return this->element_count_;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+double
+PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+getLoadFactor() {
+    return this->element_count_ / ((double) this->table_->maxNoOfElements());
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+size_t
+PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+getTableSize() {
+    return this->table_->getTableSize();
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+size_t
+PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+getTableBytes() {
+    return this->table_->getTableSize() * entries_per_bucket * bits_per_slot / 8;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+uint64_t
+PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+getSeed() {
+    return this->hash_function_->getSeed();
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t value_bits, typename hasher_type, typename index_policy>
+size_t
+PayloadFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, value_bits, hasher_type, index_policy>::
+getStashSize() {
+    return this->stash_.size();
+}
+
+#endif
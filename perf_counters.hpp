@@ -0,0 +1,201 @@
+#ifndef CUCKOOFILTER_PERF_COUNTERS_H
+#define CUCKOOFILTER_PERF_COUNTERS_H
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "bench_util.hpp"
+
+#define PERF_EVENT_COUNT 5
+
+
+/**
+ * Hardware counter values of one measured phase. Counters the kernel refused to open are not valid.
+ */
+struct PerfSample {
+    double values[PERF_EVENT_COUNT] = {};
+    bool valid[PERF_EVENT_COUNT] = {};
+};
+
+
+/**
+ * Linux hardware performance counters read through perf_event_open: cycles, instructions, last level
+ * cache misses, data TLB misses and branch misses. Only user space is counted, threads created while the
+ * counters run are included once they exit. Counts are scaled if the kernel multiplexed the counters.
+ * On other systems, or if the kernel denies access, no counter is available.
+ */
+class PerfCounters {
+
+private:
+    int fds_[PERF_EVENT_COUNT];
+
+public:
+
+    PerfCounters();
+
+    ~PerfCounters();
+
+    /**
+     * @return True if at least one counter could be opened
+     */
+    bool available() const;
+
+    /**
+     * Resetting and starting all counters.
+     */
+    void start();
+
+    /**
+     * Stopping all counters.
+     *
+     * @return Counter values since start()
+     */
+    PerfSample stop();
+
+    /**
+     * @param k Counter index
+     * @return Counter name used in benchmark output
+     */
+    static const char *name(size_t k);
+};
+
+
+inline const char *PerfCounters::name(const size_t k) {
+    static const char *names[PERF_EVENT_COUNT] = {"cycles", "instructions", "llc_misses", "dtlb_misses",
+                                                  "branch_misses"};
+    return names[k];
+}
+
+
+#ifdef __linux__
+
+inline PerfCounters::PerfCounters() {
+    const uint32_t types[PERF_EVENT_COUNT] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+                                              PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE};
+    const uint64_t configs[PERF_EVENT_COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_BRANCH_MISSES};
+
+    for (size_t k = 0; k < PERF_EVENT_COUNT; k++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = types[k];
+        attr.config = configs[k];
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        fds_[k] = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+}
+
+
+inline PerfCounters::~PerfCounters() {
+    for (size_t k = 0; k < PERF_EVENT_COUNT; k++) {
+        if (fds_[k] >= 0) {
+            close(fds_[k]);
+        }
+    }
+}
+
+
+inline void PerfCounters::start() {
+    for (size_t k = 0; k < PERF_EVENT_COUNT; k++) {
+        if (fds_[k] >= 0) {
+            ioctl(fds_[k], PERF_EVENT_IOC_RESET, 0);
+            ioctl(fds_[k], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+
+inline PerfSample PerfCounters::stop() {
+    PerfSample sample;
+    for (size_t k = 0; k < PERF_EVENT_COUNT; k++) {
+        if (fds_[k] >= 0) {
+            ioctl(fds_[k], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    for (size_t k = 0; k < PERF_EVENT_COUNT; k++) {
+        // value, time enabled, time running
+        uint64_t data[3];
+        if (fds_[k] < 0 || read(fds_[k], data, sizeof(data)) != sizeof(data) || data[2] == 0) {
+            continue;
+        }
+        sample.values[k] = data[0] * ((double) data[1] / data[2]);
+        sample.valid[k] = true;
+    }
+    return sample;
+}
+
+#else
+
+inline PerfCounters::PerfCounters() {
+    for (size_t k = 0; k < PERF_EVENT_COUNT; k++) {
+        fds_[k] = -1;
+    }
+}
+
+
+inline PerfCounters::~PerfCounters() {
+}
+
+
+inline void PerfCounters::start() {
+}
+
+
+inline PerfSample PerfCounters::stop() {
+    return PerfSample();
+}
+
+#endif
+
+
+inline bool PerfCounters::available() const {
+    for (size_t k = 0; k < PERF_EVENT_COUNT; k++) {
+        if (fds_[k] >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ * Adding per-operation counter values to a benchmark record, empty for unavailable counters.
+ *
+ * @param record Benchmark record
+ * @param sample Counter values of the phase
+ * @param ops Number of operations in the phase
+ */
+inline void addPerfSample(Record &record, const PerfSample &sample, size_t ops) {
+    for (size_t k = 0; k < PERF_EVENT_COUNT; k++) {
+        std::string column = std::string(PerfCounters::name(k)) + "_per_op";
+        if (sample.valid[k] && ops) {
+            record.add(column, sample.values[k] / ops);
+        } else {
+            record.add(column, "");
+        }
+    }
+    if (sample.valid[0] && sample.valid[1] && sample.values[0] > 0) {
+        record.add("ipc", sample.values[1] / sample.values[0]);
+    } else {
+        record.add("ipc", "");
+    }
+}
+
+#endif
@@ -0,0 +1,419 @@
+#ifndef CUCKOOFILTER_STATIC_FILTER_H
+#define CUCKOOFILTER_STATIC_FILTER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "hash_function.hpp"
+
+// every key is stored as the xor of this many array entries
+#define FUSE_ARITY 3
+// largest segment, longer segments stop improving space and hurt locality
+#define FUSE_MAX_SEGMENT_LENGTH 262144
+// construction is retried with a new seed if peeling fails, which is very unlikely for unique keys
+#define FUSE_MAX_ATTEMPTS 100
+// number of lookups whose entries are prefetched together in batched calls
+#define FUSE_BATCH_SIZE 16
+
+
+/**
+ * Key mapping of a StaticFilter built from source keys, the element hash itself is stored.
+ */
+class IdentityKeyMapping {
+
+public:
+
+    /**
+     * @param hash_value 64-bit hash value of the element
+     * @return Hash value stored in the static filter
+     */
+    inline uint64_t map(uint64_t hash_value) const {
+        return hash_value;
+    }
+};
+
+
+/**
+ * Key mapping of a StaticFilter frozen from a CuckooFilter. The cuckoo filter keeps only a fingerprint and a
+ * bucket per element, so the static filter stores the pair (smaller candidate bucket, fingerprint), which is
+ * the same whichever of the two buckets holds the fingerprint. Mirrors the index and fingerprint calculation
+ * of CuckooFilter.
+ *
+ * @tparam index_policy Index policy of the frozen filter
+ */
+template<typename index_policy>
+class CuckooKeyMapping {
+
+private:
+    index_policy index_policy_;
+    uint32_t fp_mask_;
+
+public:
+
+    /**
+     * @param policy Index policy of the frozen filter, with its table size
+     * @param fp_mask Fingerprint mask of the frozen filter
+     */
+    CuckooKeyMapping(const index_policy &policy, uint32_t fp_mask) : index_policy_(policy), fp_mask_(fp_mask) {
+    }
+
+    /**
+     * @param index Bucket holding fingerprint fp
+     * @param fp Fingerprint
+     * @return Hash value stored in the static filter
+     */
+    inline uint64_t entry(size_t index, uint32_t fp) const {
+        size_t bucket = std::min(index, index_policy_.alternate(index, fp));
+        return mixHash(((uint64_t) bucket << 32) | fp);
+    }
+
+    /**
+     * @param hash_value 64-bit hash value of the element
+     * @return Hash value stored in the static filter
+     */
+    inline uint64_t map(uint64_t hash_value) const {
+        uint32_t fp = hash_value & fp_mask_;
+        fp += (fp == 0);
+        return entry(index_policy_.index(hash_value >> 32), fp);
+    }
+};
+
+
+/**
+ * Immutable filter for sets which are built once and then only queried, a 3-wise binary fuse filter
+ * (Graf and Lemire, "Binary Fuse Filters: Fast and Smaller Than Xor Filters"). An element is contained if its
+ * fingerprint equals the xor of three array entries, so every lookup is exactly three memory accesses. The
+ * array has about 1.125 entries per element for large sets, 9 bits per element with 8-bit fingerprints, and
+ * the false positive rate is 2^-bits of fp_type. Elements cannot be added or deleted.
+ *
+ * Built either from source keys, or by CuckooFilter::freeze from the fingerprints of a cuckoo filter. In the
+ * latter case, an element colliding with a stored element in the cuckoo filter also collides in the static
+ * filter, so false positives of both add up.
+ *
+ * @tparam element_type Working element type
+ * @tparam fp_type Fingerprint type, uint8_t or uint16_t
+ * @tparam hasher_type Functor mapping keys to 64-bit hash values, see KeyHash
+ * @tparam key_mapping Maps element hash values to stored hash values, IdentityKeyMapping or CuckooKeyMapping
+ */
+template<typename element_type, typename fp_type = uint8_t, typename hasher_type = TransparentKeyHash,
+         typename key_mapping = IdentityKeyMapping>
+class StaticFilter {
+
+private:
+    // used for calculating hash values of elements
+    HashFunction<hasher_type> hash_function_;
+
+    // maps element hash values to stored hash values
+    key_mapping key_mapping_;
+
+    // seed of the construction attempt which succeeded
+    uint64_t fuse_seed_;
+
+    // number of distinct stored hash values
+    size_t size_;
+
+    uint32_t segment_length_;
+    uint32_t segment_length_mask_;
+    uint32_t segment_count_length_;
+
+    // xor of the three entries of an element is its fingerprint
+    std::vector<fp_type> fingerprints_;
+
+    /**
+     * Fingerprint of a mixed hash value.
+     */
+    inline static fp_type fingerprint(uint64_t hash);
+
+    /**
+     * Three array positions of a mixed hash value, in consecutive segments.
+     */
+    inline void positions(uint64_t hash, uint32_t *h) const;
+
+    /**
+     * Building the array from distinct stored hash values.
+     */
+    void build(std::vector<uint64_t> &keys);
+
+public:
+
+    /**
+     * Building filter from source keys.
+     *
+     * @param elements Elements of the set, duplicates are allowed
+     * @param seed Hash seed of elements
+     * @param mapping Key mapping
+     */
+    explicit StaticFilter(const std::vector<element_type> &elements, uint64_t seed = randomSeed(),
+                          key_mapping mapping = key_mapping());
+
+    /**
+     * Building filter from hash values which were already mapped by key_mapping, used by
+     * CuckooFilter::freeze.
+     *
+     * @param stored_hashes Stored hash values, duplicates are allowed
+     * @param n Number of hash values
+     * @param seed Hash seed of elements
+     * @param mapping Key mapping
+     */
+    StaticFilter(const uint64_t *stored_hashes, size_t n, uint64_t seed, key_mapping mapping = key_mapping());
+
+    /**
+     * Checking if element is contained.
+     *
+     * @param element Element to check
+     * @return True if item is contained
+     */
+    template<typename key_type = element_type>
+    bool containsElement(const key_type &element) const;
+
+    /**
+     * Checking if element given by its 64-bit hash value, computed with the filter seed, is contained.
+     *
+     * @param hash_value Hash value of the element
+     * @return True if item is contained
+     */
+    bool containsHash(uint64_t hash_value) const;
+
+    /**
+     * Checking n elements given by hash values. Entries of FUSE_BATCH_SIZE consecutive elements are
+     * prefetched before any of them is probed.
+     *
+     * @param hash_values Hash values of the elements
+     * @param n Number of elements
+     * @param results Array of size n, results[k] is set to true if k-th element is contained
+     * @return Number of contained elements
+     */
+    size_t containsHashes(const uint64_t *hash_values, size_t n, bool *results) const;
+
+    /**
+     * Retrieves number of distinct stored hash values.
+     * @return element count
+     */
+    size_t getElementCount() const;
+
+    /**
+     * Retrieves size of the fingerprint array in bytes.
+     * @return table size in bytes
+     */
+    size_t getTableBytes() const;
+
+    /**
+     * Retrieves hash seed of elements.
+     * @return hash seed
+     */
+    uint64_t getSeed() const;
+};
+
+
+template<typename element_type, typename fp_type, typename hasher_type, typename key_mapping>
+StaticFilter<element_type, fp_type, hasher_type, key_mapping>::
+StaticFilter(const std::vector<element_type> &elements, const uint64_t seed, key_mapping mapping)
+        : hash_function_(seed), key_mapping_(mapping) {
+    std::vector<uint64_t> keys(elements.size());
+    for (size_t k = 0; k < elements.size(); k++) {
+        keys[k] = key_mapping_.map(hash_function_.hash(elements[k]));
+    }
+    build(keys);
+}
+
+
+template<typename element_type, typename fp_type, typename hasher_type, typename key_mapping>
+StaticFilter<element_type, fp_type, hasher_type, key_mapping>::
+StaticFilter(const uint64_t *stored_hashes, const size_t n, const uint64_t seed, key_mapping mapping)
+        : hash_function_(seed), key_mapping_(mapping) {
+    std::vector<uint64_t> keys(stored_hashes, stored_hashes + n);
+    build(keys);
+}
+
+
+template<typename element_type, typename fp_type, typename hasher_type, typename key_mapping>
+fp_type StaticFilter<element_type, fp_type, hasher_type, key_mapping>::fingerprint(const uint64_t hash) {
+    return (fp_type) (hash ^ (hash >> 32));
+}
+
+
+template<typename element_type, typename fp_type, typename hasher_type, typename key_mapping>
+void StaticFilter<element_type, fp_type, hasher_type, key_mapping>::positions(const uint64_t hash, uint32_t *h) const {
+    // the first position is spread over all segments but the last two, the others follow it
+    h[0] = (uint32_t) (((__uint128_t) hash * segment_count_length_) >> 64);
+    h[1] = (h[0] + segment_length_) ^ ((hash >> 18) & segment_length_mask_);
+    h[2] = (h[0] + 2 * segment_length_) ^ (hash & segment_length_mask_);
+}
+
+
+template<typename element_type, typename fp_type, typename hasher_type, typename key_mapping>
+void StaticFilter<element_type, fp_type, hasher_type, key_mapping>::build(std::vector<uint64_t> &keys) {
+    // equal keys could never be peeled
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    size_ = keys.size();
+    if (size_ > UINT32_MAX / 2) {
+        throw std::runtime_error("Static filter supports at most 2^31 elements.\n");
+    }
+
+    // sizing of the reference implementation, small sets need relatively more space
+    segment_length_ = size_ == 0 ? 4 : 1U << (int) floor(log((double) size_) / log(3.33) + 2.25);
+    segment_length_ = std::min(segment_length_, (uint32_t) FUSE_MAX_SEGMENT_LENGTH);
+    segment_length_mask_ = segment_length_ - 1;
+    double size_factor = size_ <= 1 ? 0 : std::max(1.125, 0.875 + 0.25 * log(1000000.0) / log((double) size_));
+    size_t capacity = (size_t) round(size_ * size_factor);
+    size_t segment_count = (capacity + segment_length_ - 1) / segment_length_;
+    segment_count = segment_count <= FUSE_ARITY - 1 ? 1 : segment_count - (FUSE_ARITY - 1);
+    segment_count_length_ = segment_count * segment_length_;
+    const size_t array_length = (segment_count + FUSE_ARITY - 1) * segment_length_;
+    fingerprints_.assign(array_length, 0);
+
+    // per position: number of keys shifted left by 2 and xor of the key's position indices, xor of keys
+    std::vector<uint8_t> count(array_length);
+    std::vector<uint64_t> xors(array_length);
+    std::vector<uint32_t> alone(array_length);
+    // peeled keys with the index of the position they own, in peeling order
+    std::vector<uint64_t> stack(size_);
+    std::vector<uint8_t> stack_found(size_);
+    uint64_t seed_state = hash_function_.getSeed();
+    uint32_t h[FUSE_ARITY + 2];
+
+    for (int attempt = 0;; attempt++) {
+        if (attempt == FUSE_MAX_ATTEMPTS) {
+            throw std::runtime_error("Static filter construction failed.\n");
+        }
+        seed_state += MURMUR_CONST_64;
+        fuse_seed_ = mixHash(seed_state);
+        memset(count.data(), 0, array_length);
+        memset(xors.data(), 0, array_length * sizeof(uint64_t));
+
+        bool overflow = false;
+        for (uint64_t key : keys) {
+            uint64_t hash = mixHash(key + fuse_seed_);
+            positions(hash, h);
+            for (uint8_t k = 0; k < FUSE_ARITY; k++) {
+                count[h[k]] += 4;
+                count[h[k]] ^= k;
+                xors[h[k]] ^= hash;
+                overflow |= count[h[k]] < 4;
+            }
+        }
+        if (overflow) {
+            continue;
+        }
+
+        // peeling: a position used by a single key determines that key's entry
+        size_t queue = 0;
+        for (uint32_t i = 0; i < array_length; i++) {
+            alone[queue] = i;
+            queue += (count[i] >> 2) == 1;
+        }
+        size_t peeled = 0;
+        while (queue > 0) {
+            uint32_t index = alone[--queue];
+            if ((count[index] >> 2) != 1) {
+                continue;
+            }
+            uint64_t hash = xors[index];
+            uint8_t found = count[index] & 3;
+            stack[peeled] = hash;
+            stack_found[peeled] = found;
+            peeled++;
+
+            positions(hash, h);
+            h[3] = h[0];
+            h[4] = h[1];
+            for (uint8_t k = 1; k < FUSE_ARITY; k++) {
+                uint32_t other = h[found + k];
+                alone[queue] = other;
+                queue += (count[other] >> 2) == 2;
+                count[other] -= 4;
+                count[other] ^= (found + k) % FUSE_ARITY;
+                xors[other] ^= hash;
+            }
+        }
+        if (peeled == size_) {
+            break;
+        }
+    }
+
+    // assigning in reverse peeling order, the owned position of a key is not used by keys peeled before it
+    for (size_t i = size_; i-- > 0;) {
+        uint64_t hash = stack[i];
+        positions(hash, h);
+        h[3] = h[0];
+        h[4] = h[1];
+        uint8_t found = stack_found[i];
+        fingerprints_[h[found]] = fingerprint(hash) ^ fingerprints_[h[found + 1]] ^ fingerprints_[h[found + 2]];
+    }
+}
+
+
+template<typename element_type, typename fp_type, typename hasher_type, typename key_mapping>
+template<typename key_type>
+bool StaticFilter<element_type, fp_type, hasher_type, key_mapping>::containsElement(const key_type &element) const {
+    return containsHash(hash_function_.hash(element));
+}
+
+
+template<typename element_type, typename fp_type, typename hasher_type, typename key_mapping>
+bool StaticFilter<element_type, fp_type, hasher_type, key_mapping>::containsHash(const uint64_t hash_value) const {
+    if (size_ == 0) {
+        return false;
+    }
+    uint64_t hash = mixHash(key_mapping_.map(hash_value) + fuse_seed_);
+    uint32_t h[FUSE_ARITY];
+    positions(hash, h);
+    return fingerprint(hash) == (fp_type) (fingerprints_[h[0]] ^ fingerprints_[h[1]] ^ fingerprints_[h[2]]);
+}
+
+
+template<typename element_type, typename fp_type, typename hasher_type, typename key_mapping>
+size_t StaticFilter<element_type, fp_type, hasher_type, key_mapping>::
+containsHashes(const uint64_t *hash_values, const size_t n, bool *results) const {
+    size_t contained = 0;
+    uint64_t hashes[FUSE_BATCH_SIZE];
+    uint32_t h[FUSE_BATCH_SIZE][FUSE_ARITY];
+
+    if (size_ == 0) {
+        std::fill(results, results + n, false);
+        return 0;
+    }
+    for (size_t start = 0; start < n; start += FUSE_BATCH_SIZE) {
+        size_t count = std::min(n - start, (size_t) FUSE_BATCH_SIZE);
+        for (size_t k = 0; k < count; k++) {
+            hashes[k] = mixHash(key_mapping_.map(hash_values[start + k]) + fuse_seed_);
+            positions(hashes[k], h[k]);
+            __builtin_prefetch(&fingerprints_[h[k][0]], 0);
+            __builtin_prefetch(&fingerprints_[h[k][1]], 0);
+            __builtin_prefetch(&fingerprints_[h[k][2]], 0);
+        }
+        for (size_t k = 0; k < count; k++) {
+            fp_type x = fingerprints_[h[k][0]] ^ fingerprints_[h[k][1]] ^ fingerprints_[h[k][2]];
+            bool found = fingerprint(hashes[k]) == x;
+            results[start + k] = found;
+            contained += found;
+        }
+    }
+    return contained;
+}
+
+
+template<typename element_type, typename fp_type, typename hasher_type, typename key_mapping>
+size_t StaticFilter<element_type, fp_type, hasher_type, key_mapping>::getElementCount() const {
+    return size_;
+}
+
+
+template<typename element_type, typename fp_type, typename hasher_type, typename key_mapping>
+size_t StaticFilter<element_type, fp_type, hasher_type, key_mapping>::getTableBytes() const {
+    return fingerprints_.size() * sizeof(fp_type);
+}
+
+
+template<typename element_type, typename fp_type, typename hasher_type, typename key_mapping>
+uint64_t StaticFilter<element_type, fp_type, hasher_type, key_mapping>::getSeed() const {
+    return hash_function_.getSeed();
+}
+
+#endif
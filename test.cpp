@@ -1,151 +1,1635 @@
-#include <chrono>
-#include <iostream>
+#include <math.h>
+#include <stdlib.h>
+#include <unistd.h>
 #include <fstream>
+#include <iostream>
+#include <memory>
+#include <deque>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
+#include "bench_util.hpp"
 #include "cuckoo_filter.hpp"
+#include "cuckoo_map.hpp"
+#include "interleaved_lookup.hpp"
+#include "morton_filter.hpp"
+#include "payload_filter.hpp"
+#include "perf_counters.hpp"
+#include "static_filter.hpp"
+#include "windowed_filter.hpp"
+
+// operations timed together, per-operation latency percentiles are computed over batches
+#define BENCH_BATCH_OPS 256
+// storage tiers of the payload benchmark, a tier fits into 2 payload bits
+#define PAYLOAD_TIERS 4
+// generation periods streamed by the window benchmark
+#define WINDOW_PERIODS 12
+
+
+/**
+ * Benchmark parameters, every combination of the listed values is measured.
+ */
+struct BenchConfig {
+    // table sizes in bytes, from L1-resident up to the configured maximum
+    std::vector<size_t> table_bytes;
+    // fraction of table entries filled before lookups and deletions are measured
+    std::vector<double> loads;
+    // fraction of lookups querying inserted keys
+    std::vector<double> hit_ratios;
+    // number of threads issuing lookups concurrently
+    std::vector<size_t> threads;
+    // lookup modes of the filter, "sequential" or "speculative"
+    std::vector<std::string> lookup_modes;
+    // bucket index schemes of the filter benchmark, "xor", "modular" or "vacuum"
+    std::vector<std::string> index_policies;
+    // numbers of lookups kept in flight by InterleavedLookup
+    std::vector<size_t> depths;
+    // number of lookups per (load, hit ratio, threads) combination
+    size_t lookups;
+    // hash seed of the filters and salt of the keys
+    uint64_t seed;
+    // layout names to run, empty runs all
+    std::vector<std::string> layouts;
+    // upper edges of load factor ranges in which insertion latency percentiles are reported
+    std::vector<double> load_edges;
+    // report hardware counters per operation for every measured phase
+    bool perf;
+    // mixed workloads as lookup/insert/delete percentages, e.g. "90/9/1"
+    std::vector<std::string> mixes;
+    // key popularity of mixed workload lookups, "uniform" or "zipf"
+    std::vector<std::string> distributions;
+    // skew of the zipfian distribution
+    double zipf_theta;
+    // duration of each mixed workload run
+    size_t duration_ms;
+    // query sets of the false positive rate measurement
+    std::vector<std::string> query_sets;
+    // confidence level of false positive rate intervals
+    double confidence;
+};
+
+
+/**
+ * Running fn(k) for every k in [from, to) in batches, recording average latency of each batch.
+ *
+ * @return Total elapsed time in nanoseconds
+ */
+template<typename Fn>
+uint64_t timeBatches(size_t from, size_t to, std::vector<double> &samples, Fn fn) {
+    uint64_t total = 0;
+    for (size_t start = from; start < to; start += BENCH_BATCH_OPS) {
+        size_t end = std::min(to, start + BENCH_BATCH_OPS);
+        uint64_t begin = nowNs();
+        for (size_t k = start; k < end; k++) {
+            fn(k);
+        }
+        uint64_t elapsed = nowNs() - begin;
+        samples.push_back(elapsed / (double) (end - start));
+        total += elapsed;
+    }
+    return total;
+}
+
+
+/**
+ * Like timeBatches, but a call of fn returning false is the last one. The batch it ends is recorded over
+ * the calls actually made, so stopping early does not dilute latency with untimed work.
+ *
+ * @return Total elapsed time in nanoseconds
+ */
+template<typename Fn>
+uint64_t timeBatchesWhile(size_t from, size_t to, std::vector<double> &samples, Fn fn) {
+    uint64_t total = 0;
+    bool more = true;
+    for (size_t start = from; more && start < to; start += BENCH_BATCH_OPS) {
+        size_t end = std::min(to, start + BENCH_BATCH_OPS);
+        size_t k = start;
+        uint64_t begin = nowNs();
+        while (more && k < end) {
+            more = fn(k++);
+        }
+        uint64_t elapsed = nowNs() - begin;
+        samples.push_back(elapsed / (double) (k - start));
+        total += elapsed;
+    }
+    return total;
+}
+
+
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type, typename index_policy>
+Record layoutRecord(const std::string &layout,
+                    CuckooFilter<uint64_t, entries_per_bucket, bits_per_fp, fp_type, TransparentKeyHash,
+                                 index_policy> &filter,
+                    double target_load) {
+    const size_t bytes = filter.getTableSize() * entries_per_bucket * bits_per_fp / 8;
+    Record record;
+    record.add("layout", layout)
+            .add("index_policy", index_policy::name())
+            .add("entries_per_bucket", entries_per_bucket)
+            .add("bits_per_fp", bits_per_fp)
+            .add("buckets", filter.getTableSize())
+            .add("table_bytes", bytes)
+            .add("target_load", target_load)
+            .add("load", filter.getLoadFactor())
+            .add("bits_per_key", filter.getElementCount() ? bytes * 8.0 / filter.getElementCount() : 0.0);
+    return record;
+}
+
+
+template<typename index_policy>
+Record layoutRecord(const std::string &layout, MortonFilter<uint64_t, TransparentKeyHash, index_policy> &filter,
+                    double target_load) {
+    const size_t bytes = filter.getTableBytes();
+    Record record;
+    record.add("layout", layout)
+            .add("index_policy", index_policy::name())
+            .add("entries_per_bucket", MORTON_BUCKET_CAPACITY)
+            .add("bits_per_fp", 8)
+            .add("buckets", filter.getTableSize())
+            .add("table_bytes", bytes)
+            .add("target_load", target_load)
+            .add("load", filter.getLoadFactor())
+            .add("bits_per_key", filter.getElementCount() ? bytes * 8.0 / filter.getElementCount() : 0.0);
+    return record;
+}
+
+
+void addThroughput(Record &record, size_t ops, uint64_t elapsed_ns, std::vector<double> &samples) {
+    record.add("ops", ops)
+            .add("ns_per_op", ops ? elapsed_ns / (double) ops : 0.0)
+            .add("mops", elapsed_ns ? ops * 1000.0 / elapsed_ns : 0.0)
+            .add("batch", summarize(samples));
+}
+
+
+/**
+ * Measuring insertion up to each load factor, lookups for each hit ratio and thread count, and deletion
+ * of all inserted keys, for every table size.
+ *
+ * @tparam Filter CuckooFilter or MortonFilter with uint64_t keys, described by a layoutRecord overload
+ * @param bytes_per_bucket Table bytes per bucket, converts table sizes in bytes to numbers of buckets
+ */
+template<typename Filter>
+void benchmarkFilter(const std::string &layout, size_t bytes_per_bucket, const BenchConfig &config,
+                     ResultWriter &writer) {
+    if (!config.layouts.empty() &&
+        std::find(config.layouts.begin(), config.layouts.end(), layout) == config.layouts.end()) {
+        return;
+    }
+
+    const uint64_t salt = config.seed;
+    PerfCounters perf;
+    PerfSample perf_sample;
+    // keys numbered from negative_base on are never inserted
+    const uint64_t negative_base = 1ULL << 62;
+
+    for (size_t table_bytes : config.table_bytes) {
+        for (double load : config.loads) {
+            std::unique_ptr<Filter> filter(new Filter(table_bytes / bytes_per_bucket, STASH_DEFAULT_SIZE,
+                                                      config.seed));
+            const size_t target = (size_t) (load * filter->getLoad().capacity);
+
+            // insertion until the target load is reached or the filter rejects a key
+            std::vector<double> samples;
+            size_t inserted = 0;
+            perf.start();
+            uint64_t elapsed = timeBatchesWhile(0, target, samples, [&](size_t k) {
+                if (!filter->insertElement(benchKey(k, salt))) {
+                    return false;
+                }
+                inserted++;
+                return true;
+            });
+            perf_sample = perf.stop();
+            // the rejected insertion was timed as well
+            const size_t attempts = std::min(target, inserted + 1);
+            Record record = layoutRecord(layout, *filter, load);
+            record.add("op", "insert").add("threads", 1).add("hit_ratio", "").add("fpr", "")
+                    .add("depth", "").add("lookup_mode", "");
+            addThroughput(record, attempts, elapsed, samples);
+            if (config.perf) addPerfSample(record, perf_sample, attempts);
+            writer.write(record);
+
+            for (double hit_ratio : config.hit_ratios) {
+                std::vector<uint64_t> queries(config.lookups);
+                std::vector<uint8_t> positive(config.lookups);
+                std::mt19937_64 rng(config.seed ^ (uint64_t) (hit_ratio * 1000));
+                std::uniform_real_distribution<double> coin(0, 1);
+                for (size_t q = 0; q < config.lookups; q++) {
+                    positive[q] = inserted && coin(rng) < hit_ratio;
+                    queries[q] = positive[q] ? benchKey(rng() % inserted, salt) : benchKey(negative_base + q, salt);
+                }
+
+                for (const std::string &mode_name : config.lookup_modes) {
+                    filter->setLookupMode(mode_name == "speculative" ? LookupMode::Speculative
+                                                                     : LookupMode::Sequential);
+                    for (size_t threads : config.threads) {
+                        std::vector<std::vector<double>> thread_samples(threads);
+                        std::vector<size_t> false_positives(threads, 0);
+                        std::vector<std::thread> workers;
+                        const size_t per_thread = (config.lookups + threads - 1) / threads;
+
+                        perf.start();
+                        uint64_t begin = nowNs();
+                        for (size_t t = 0; t < threads; t++) {
+                            workers.emplace_back([&, t]() {
+                                size_t from = std::min(config.lookups, t * per_thread);
+                                size_t to = std::min(config.lookups, from + per_thread);
+                                timeBatches(from, to, thread_samples[t], [&](size_t q) {
+                                    bool found = filter->containsElement(queries[q]);
+                                    false_positives[t] += found && !positive[q];
+                                });
+                            });
+                        }
+                        for (std::thread &worker : workers) {
+                            worker.join();
+                        }
+                        elapsed = nowNs() - begin;
+                        perf_sample = perf.stop();
+
+                        size_t negatives = 0;
+                        size_t fp_total = 0;
+                        for (size_t q = 0; q < config.lookups; q++) {
+                            negatives += !positive[q];
+                        }
+                        samples.clear();
+                        for (size_t t = 0; t < threads; t++) {
+                            fp_total += false_positives[t];
+                            samples.insert(samples.end(), thread_samples[t].begin(), thread_samples[t].end());
+                        }
+
+                        record = layoutRecord(layout, *filter, load);
+                        record.add("op", "lookup").add("threads", threads).add("hit_ratio", hit_ratio)
+                                .add("fpr", negatives ? fp_total / (double) negatives : 0.0).add("depth", "")
+                                .add("lookup_mode", mode_name);
+                        addThroughput(record, config.lookups, elapsed, samples);
+                        if (config.perf) addPerfSample(record, perf_sample, config.lookups);
+                        writer.write(record);
+                    }
+                }
+
+                // single thread issuing lookups one by one through the interleaved engine
+                for (size_t depth : config.depths) {
+                    InterleavedLookup<Filter> engine(*filter, depth);
+                    LookupCompletion completion;
+                    size_t fp_total = 0;
+                    size_t negatives = 0;
+                    samples.clear();
+
+                    perf.start();
+                    elapsed = timeBatches(0, config.lookups, samples, [&](size_t q) {
+                        if (engine.submit(queries[q], q, &completion)) {
+                            fp_total += completion.found && !positive[completion.tag];
+                        }
+                    });
+                    uint64_t begin = nowNs();
+                    while (engine.flush(&completion)) {
+                        fp_total += completion.found && !positive[completion.tag];
+                    }
+                    elapsed += nowNs() - begin;
+                    perf_sample = perf.stop();
+                    for (size_t q = 0; q < config.lookups; q++) {
+                        negatives += !positive[q];
+                    }
+
+                    record = layoutRecord(layout, *filter, load);
+                    record.add("op", "lookup_interleaved").add("threads", 1).add("hit_ratio", hit_ratio)
+                            .add("fpr", negatives ? fp_total / (double) negatives : 0.0).add("depth", depth)
+                            .add("lookup_mode", "");
+                    addThroughput(record, config.lookups, elapsed, samples);
+                    if (config.perf) addPerfSample(record, perf_sample, config.lookups);
+                    writer.write(record);
+                }
+            }
+
+            // deletion of every inserted key
+            samples.clear();
+            record = layoutRecord(layout, *filter, load);
+            perf.start();
+            elapsed = timeBatches(0, inserted, samples, [&](size_t k) {
+                filter->deleteElement(benchKey(k, salt));
+            });
+            perf_sample = perf.stop();
+            record.add("op", "delete").add("threads", 1).add("hit_ratio", "").add("fpr", "")
+                    .add("depth", "").add("lookup_mode", "");
+            addThroughput(record, inserted, elapsed, samples);
+            if (config.perf) addPerfSample(record, perf_sample, inserted);
+            writer.write(record);
+        }
+    }
+}
+
+
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type, typename index_policy>
+void benchmarkLayout(const std::string &layout, const BenchConfig &config, ResultWriter &writer) {
+    typedef CuckooFilter<uint64_t, entries_per_bucket, bits_per_fp, fp_type, TransparentKeyHash, index_policy> Filter;
+    benchmarkFilter<Filter>(layout, entries_per_bucket * bits_per_fp / 8, config, writer);
+}
+
+
+template<typename index_policy>
+void benchmarkLayouts(const BenchConfig &config, ResultWriter &writer) {
+    benchmarkLayout<4, 4, uint8_t, index_policy>("4x4", config, writer);
+    benchmarkLayout<4, 8, uint8_t, index_policy>("4x8", config, writer);
+    benchmarkLayout<4, 12, uint16_t, index_policy>("4x12", config, writer);
+    benchmarkLayout<4, 16, uint16_t, index_policy>("4x16", config, writer);
+    benchmarkLayout<2, 32, uint32_t, index_policy>("2x32", config, writer);
+    // a block of MORTON_BLOCK_BYTES bytes holds MORTON_BUCKETS buckets, one byte per bucket
+    benchmarkFilter<MortonFilter<uint64_t, TransparentKeyHash, index_policy>>("morton", 1, config, writer);
+}
+
+
+/**
+ * Filling each table until it rejects a key, timing every insertion on its own. Latency percentiles are
+ * reported per load factor range given by config.load_edges, so the cost of long kick chains near
+ * capacity is visible instead of being averaged out.
+ *
+ * @param strategy Name of the insertion strategy, reported in the output
+ * @param insert Callable inserting key into filter, returning InsertStatus
+ */
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type, typename InsertFn>
+void benchmarkInsertTail(const std::string &layout, const std::string &strategy, const BenchConfig &config,
+                         ResultWriter &writer, InsertFn insert) {
+    typedef CuckooFilter<uint64_t, entries_per_bucket, bits_per_fp, fp_type> Filter;
+
+    if (!config.layouts.empty() &&
+        std::find(config.layouts.begin(), config.layouts.end(), layout) == config.layouts.end()) {
+        return;
+    }
+
+    const size_t bytes_per_bucket = entries_per_bucket * bits_per_fp / 8;
+
+    // cost of reading the clock, included in every sample
+    uint64_t overhead_begin = nowNs();
+    for (int k = 0; k < 1000; k++) {
+        nowNs();
+    }
+    const double timer_overhead = (nowNs() - overhead_begin) / 1000.0;
+
+    for (size_t table_bytes : config.table_bytes) {
+        std::unique_ptr<Filter> filter(new Filter(table_bytes / bytes_per_bucket, STASH_DEFAULT_SIZE, config.seed));
+        const double capacity = filter->getTableSize() * entries_per_bucket;
+
+        std::vector<std::vector<double>> samples(config.load_edges.size());
+        std::vector<size_t> stashed(config.load_edges.size(), 0);
+        size_t range = 0;
+        InsertStatus status = InsertStatus::Inserted;
+
+        for (uint64_t k = 0; status != InsertStatus::RejectedFull && range < config.load_edges.size(); k++) {
+            while (range < config.load_edges.size() &&
+                   filter->getElementCount() >= config.load_edges[range] * capacity) {
+                range++;
+            }
+            if (range == config.load_edges.size()) {
+                break;
+            }
+            uint64_t key = benchKey(k, config.seed);
+            uint64_t begin = nowNs();
+            status = insert(*filter, key);
+            uint64_t elapsed = nowNs() - begin;
+            samples[range].push_back(elapsed);
+            stashed[range] += status == InsertStatus::Stashed;
+        }
+
+        for (size_t r = 0; r < config.load_edges.size(); r++) {
+            if (samples[r].empty()) {
+                continue;
+            }
+            Record record;
+            record.add("layout", layout)
+                    .add("strategy", strategy)
+                    .add("buckets", filter->getTableSize())
+                    .add("table_bytes", filter->getTableSize() * bytes_per_bucket)
+                    .add("load_from", r ? config.load_edges[r - 1] : 0.0)
+                    .add("load_to", config.load_edges[r])
+                    .add("ops", samples[r].size())
+                    .add("stashed", stashed[r])
+                    .add("timer_overhead_ns", timer_overhead)
+                    .add("insert", summarize(samples[r]));
+            writer.write(record);
+        }
+    }
+}
+
+
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+void benchmarkInsertTail(const std::string &layout, const BenchConfig &config, ResultWriter &writer) {
+    typedef CuckooFilter<uint64_t, entries_per_bucket, bits_per_fp, fp_type> Filter;
+    benchmarkInsertTail<entries_per_bucket, bits_per_fp, fp_type>(
+            layout, "random_walk", config, writer,
+            [](Filter &filter, uint64_t key) { return filter.tryInsertElement(key); });
+    benchmarkInsertTail<entries_per_bucket, bits_per_fp, fp_type>(
+            layout, "insert_if_absent", config, writer,
+            [](Filter &filter, uint64_t key) { return filter.insertIfAbsent(key); });
+}
+
+
+/**
+ * Per-thread result of a mixed workload run.
+ */
+struct MixedThreadResult {
+    size_t lookups = 0;
+    size_t inserts = 0;
+    size_t deletes = 0;
+    size_t rejected = 0;
+    // lookups of keys this thread inserted and did not delete, answered negatively
+    size_t false_negatives = 0;
+    // lookups of never inserted keys, and how many of them were answered positively
+    size_t negative_lookups = 0;
+    size_t false_positives = 0;
+};
+
+
+/**
+ * Running a mixed lookup/insert/delete workload from several threads against one shared filter held at
+ * a fixed load. A target load the layout cannot reach is lowered to the load at which the initial fill first
+ * failed to place a key, the row reports the load actually reached. Every thread owns a disjoint key range
+ * and remembers which of its keys are present, so it can check that none of them is ever reported missing.
+ * The filter is not thread-safe for writers, lookups share a reader-writer lock and insertions and
+ * deletions take it exclusively.
+ */
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+void benchmarkMixed(const std::string &layout, const BenchConfig &config, ResultWriter &writer, bool &failed) {
+    typedef CuckooFilter<uint64_t, entries_per_bucket, bits_per_fp, fp_type> Filter;
+
+    if (!config.layouts.empty() &&
+        std::find(config.layouts.begin(), config.layouts.end(), layout) == config.layouts.end()) {
+        return;
+    }
+
+    const size_t bytes_per_bucket = entries_per_bucket * bits_per_fp / 8;
+    // keys of thread t are numbered from t * key_space, never inserted keys from negative_base
+    const uint64_t key_space = 1ULL << 40;
+    const uint64_t negative_base = 1ULL << 62;
+
+    for (size_t table_bytes : config.table_bytes) {
+        for (double load : config.loads) {
+            for (const std::string &mix : config.mixes) {
+                std::string list = mix;
+                std::replace(list.begin(), list.end(), '/', ',');
+                std::vector<double> shares = parseList<double>(list);
+                if (shares.size() != 3) {
+                    std::cerr << "Invalid mix " << mix << std::endl;
+                    failed = true;
+                    return;
+                }
+                const double total_share = shares[0] + shares[1] + shares[2];
+
+                for (const std::string &distribution : config.distributions) {
+                    for (size_t threads : config.threads) {
+                        Filter filter(table_bytes / bytes_per_bucket, STASH_DEFAULT_SIZE, config.seed);
+                        std::shared_mutex lock;
+                        size_t quota = std::max((size_t) 3,
+                                                (size_t) (load * filter.getTableSize() * entries_per_bucket /
+                                                          threads));
+
+                        // present keys of every thread, newest at the back, and next unused key number
+                        std::vector<std::deque<uint64_t>> present(threads);
+                        std::vector<uint64_t> next_key(threads);
+                        for (size_t t = 0; t < threads; t++) {
+                            next_key[t] = t * key_space;
+                        }
+                        // threads are filled in turns, the fill stops at the first key the table cannot place,
+                        // so a target above the reachable load is capped instead of saturating the stash
+                        bool fill_capped = false;
+                        while (!fill_capped && present[threads - 1].size() < quota) {
+                            for (size_t t = 0; t < threads && !fill_capped; t++) {
+                                uint64_t key = benchKey(next_key[t]++, config.seed);
+                                InsertStatus status = filter.tryInsertElement(key);
+                                if (status != InsertStatus::RejectedFull) {
+                                    present[t].push_back(key);
+                                }
+                                fill_capped = status != InsertStatus::Inserted;
+                            }
+                        }
+                        if (fill_capped) {
+                            quota = std::max((size_t) 1, present[threads - 1].size());
+                        }
+                        const double fill_load = filter.getLoadFactor();
+                        const ZipfGenerator zipf(quota, config.zipf_theta);
+
+                        std::vector<MixedThreadResult> results(threads);
+                        std::vector<std::thread> workers;
+                        const uint64_t deadline = nowNs() + config.duration_ms * 1000000ULL;
+                        uint64_t begin = nowNs();
+                        for (size_t t = 0; t < threads; t++) {
+                            workers.emplace_back([&, t]() {
+                                std::mt19937_64 rng(config.seed + t);
+                                std::uniform_real_distribution<double> uniform(0, 1);
+                                std::deque<uint64_t> &keys = present[t];
+                                MixedThreadResult &result = results[t];
+                                uint64_t negative = negative_base + t * key_space;
+
+                                while (nowNs() < deadline) {
+                                    for (int k = 0; k < 64; k++) {
+                                        double op = uniform(rng) * total_share;
+                                        if (op < shares[0]) {
+                                            // half of lookups query present keys, the other half absent ones
+                                            bool hit = !keys.empty() && (rng() & 1);
+                                            uint64_t key;
+                                            if (hit) {
+                                                size_t rank = distribution == "zipf" ? zipf.next(uniform(rng))
+                                                                                     : rng() % keys.size();
+                                                key = keys[keys.size() - 1 - std::min(rank, keys.size() - 1)];
+                                            } else {
+                                                key = benchKey(negative++, config.seed);
+                                            }
+                                            bool found;
+                                            {
+                                                std::shared_lock<std::shared_mutex> guard(lock);
+                                                found = filter.containsElement(key);
+                                            }
+                                            result.lookups++;
+                                            result.false_negatives += hit && !found;
+                                            result.negative_lookups += !hit;
+                                            result.false_positives += !hit && found;
+                                        } else if (op < shares[0] + shares[1]) {
+                                            // the oldest key is replaced to keep the load fixed
+                                            uint64_t key = benchKey(next_key[t]++, config.seed);
+                                            std::unique_lock<std::shared_mutex> guard(lock);
+                                            if (keys.size() >= quota) {
+                                                filter.deleteElement(keys.front());
+                                                keys.pop_front();
+                                            }
+                                            if (filter.insertElement(key)) {
+                                                keys.push_back(key);
+                                            } else {
+                                                result.rejected++;
+                                            }
+                                            result.inserts++;
+                                        } else {
+                                            std::unique_lock<std::shared_mutex> guard(lock);
+                                            if (!keys.empty()) {
+                                                filter.deleteElement(keys.front());
+                                                keys.pop_front();
+                                            }
+                                            result.deletes++;
+                                        }
+                                    }
+                                }
+                            });
+                        }
+                        for (std::thread &worker : workers) {
+                            worker.join();
+                        }
+                        const double seconds = (nowNs() - begin) / 1e9;
+
+                        MixedThreadResult total;
+                        double sum = 0, sum_squares = 0, min_ops = -1, max_ops = 0;
+                        for (const MixedThreadResult &result : results) {
+                            double ops = result.lookups + result.inserts + result.deletes;
+                            sum += ops;
+                            sum_squares += ops * ops;
+                            min_ops = min_ops < 0 ? ops : std::min(min_ops, ops);
+                            max_ops = std::max(max_ops, ops);
+                            total.lookups += result.lookups;
+                            total.inserts += result.inserts;
+                            total.deletes += result.deletes;
+                            total.rejected += result.rejected;
+                            total.false_negatives += result.false_negatives;
+                            total.negative_lookups += result.negative_lookups;
+                            total.false_positives += result.false_positives;
+                        }
+                        failed |= total.false_negatives > 0;
+
+                        Record record;
+                        record.add("layout", layout)
+                                .add("buckets", filter.getTableSize())
+                                .add("table_bytes", filter.getTableSize() * bytes_per_bucket)
+                                .add("target_load", load)
+                                .add("fill_load", fill_load)
+                                .add("fill_capped", fill_capped)
+                                .add("load", filter.getLoadFactor())
+                                .add("mix", mix)
+                                .add("distribution", distribution)
+                                .add("threads", threads)
+                                .add("seconds", seconds)
+                                .add("ops", sum)
+                                .add("mops", sum / seconds / 1e6)
+                                .add("lookups", total.lookups)
+                                .add("inserts", total.inserts)
+                                .add("deletes", total.deletes)
+                                .add("rejected", total.rejected)
+                                .add("fpr", total.negative_lookups ? total.false_positives /
+                                                                     (double) total.negative_lookups : 0.0)
+                                .add("false_negatives", total.false_negatives)
+                                // Jain's index, 1 if every thread completed the same number of operations
+                                .add("fairness", sum_squares ? sum * sum / (threads * sum_squares) : 1.0)
+                                .add("min_max_ratio", max_ops ? min_ops / max_ops : 1.0);
+                        writer.write(record);
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+/**
+ * Expected false positive rate of a filter at the given load. A key collides with a stored one if both
+ * have the same fingerprint and bucket pair, stored keys with fingerprint f sharing the pair of the query
+ * are Poisson distributed with mean 2 * entries_per_bucket * load * P(f) for large tables. Fingerprints are
+ * uniform over 1 to 2^bits - 1, except 1 which also replaces zero and is twice as likely.
+ *
+ * @return Probability that a key which was never inserted is reported as contained
+ */
+double expectedFpr(size_t entries_per_bucket, size_t bits_per_fp, double load) {
+    const double p = ldexp(1, -(int) bits_per_fp);
+    const double mean = 2.0 * entries_per_bucket * load;
+    return 2 * p * -expm1(-mean * 2 * p) + (1 - 2 * p) * -expm1(-mean * p);
+}
+
+
+/**
+ * Generating queries for keys which were never inserted.
+ *
+ * random: benchmark keys from a range disjoint from inserted ones.
+ * sequential: consecutive integers, shows whether structured keys correlate with the hash.
+ * bitflip: inserted keys with one bit flipped, i.e. keys close to members.
+ * adversarial: false positives of a filter holding the same keys under another seed, as an attacker
+ * probing a filter they can observe would collect them. Reports how well the seed protects the filter.
+ * At most 64 candidates per query are probed, fewer queries are returned for filters with low FPR.
+ */
+template<typename Filter>
+std::vector<uint64_t> fprQueries(const std::string &query_set, size_t count, size_t inserted,
+                                 const Filter &twin, const BenchConfig &config) {
+    const uint64_t negative_base = 1ULL << 62;
+    std::vector<uint64_t> queries;
+    queries.reserve(count);
+    if (query_set == "random") {
+        for (size_t q = 0; q < count; q++) {
+            queries.push_back(benchKey(negative_base + q, config.seed));
+        }
+    } else if (query_set == "sequential") {
+        for (size_t q = 0; q < count; q++) {
+            queries.push_back(negative_base + q);
+        }
+    } else if (query_set == "bitflip") {
+        std::mt19937_64 rng(config.seed);
+        for (size_t q = 0; q < count && inserted; q++) {
+            queries.push_back(benchKey(rng() % inserted, config.seed) ^ (1ULL << (rng() % 64)));
+        }
+    } else if (query_set == "adversarial") {
+        for (uint64_t candidate = 0; candidate < 64 * count && queries.size() < count; candidate++) {
+            uint64_t key = benchKey(negative_base + candidate, config.seed);
+            if (twin.containsElement(key)) {
+                queries.push_back(key);
+            }
+        }
+    }
+    return queries;
+}
+
+
+/**
+ * Measuring false positive rate of every query set at each load factor, with confidence interval, next to
+ * the expected rate. Loads are reached in increasing order by inserting into the same filter.
+ */
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+void benchmarkFpr(const std::string &layout, const BenchConfig &config, ResultWriter &writer) {
+    typedef CuckooFilter<uint64_t, entries_per_bucket, bits_per_fp, fp_type> Filter;
+
+    if (!config.layouts.empty() &&
+        std::find(config.layouts.begin(), config.layouts.end(), layout) == config.layouts.end()) {
+        return;
+    }
+
+    const size_t bytes_per_bucket = entries_per_bucket * bits_per_fp / 8;
+    std::vector<double> loads = config.loads;
+    std::sort(loads.begin(), loads.end());
+
+    for (size_t table_bytes : config.table_bytes) {
+        Filter filter(table_bytes / bytes_per_bucket, STASH_DEFAULT_SIZE, config.seed);
+        Filter twin(table_bytes / bytes_per_bucket, STASH_DEFAULT_SIZE, config.seed ^ MURMUR_CONST_64);
+        size_t inserted = 0;
+        bool full = false;
+
+        for (double load : loads) {
+            const size_t target = (size_t) (load * filter.getTableSize() * entries_per_bucket);
+            while (!full && inserted < target) {
+                uint64_t key = benchKey(inserted, config.seed);
+                if (filter.insertElement(key)) {
+                    twin.insertElement(key);
+                    inserted++;
+                } else {
+                    full = true;
+                }
+            }
+
+            for (const std::string &query_set : config.query_sets) {
+                std::vector<uint64_t> queries = fprQueries(query_set, config.lookups, inserted, twin, config);
+                if (queries.empty()) {
+                    // e.g. adversarial keys of low false positive layouts, nothing was measured
+                    continue;
+                }
+                size_t false_positives = 0;
+                for (uint64_t key : queries) {
+                    false_positives += filter.containsElement(key);
+                }
+
+                const double expected = expectedFpr(entries_per_bucket, bits_per_fp, filter.getLoadFactor());
+                const std::pair<double, double> interval = wilsonInterval(false_positives, queries.size(),
+                                                                          config.confidence);
+                Record record = layoutRecord(layout, filter, load);
+                record.add("query_set", query_set)
+                        .add("queries", queries.size())
+                        .add("false_positives", false_positives)
+                        .add("fpr", false_positives / (double) queries.size())
+                        .add("fpr_low", interval.first)
+                        .add("fpr_high", interval.second)
+                        .add("confidence", config.confidence)
+                        .add("fpr_expected", expected)
+                        // rate of a completely full table, the usual 2b / 2^f bound
+                        .add("fpr_bound", expectedFpr(entries_per_bucket, bits_per_fp, 1))
+                        .add("expected_in_interval", interval.first <= expected && expected <= interval.second);
+                writer.write(record);
+            }
+        }
+    }
+}
 
 
-template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
-int insertIntsInRange(CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type> *filter, size_t from,
-                      size_t to) {
-    assert(from < to);
+/**
+ * Lookups of a filter built for the freeze benchmark, one by one and batched, with false positive rate
+ * of the negative queries.
+ *
+ * @param name Filter name reported in the output
+ * @param build_ns Time the filter took to build, inserting or freezing
+ */
+template<typename Filter>
+void freezeRecords(const std::string &name, Filter &filter, size_t table_bytes, size_t elements, uint64_t build_ns,
+                   const std::vector<uint64_t> &queries, const std::vector<uint8_t> &positive, double hit_ratio,
+                   ResultWriter &writer) {
+    HashFunction<TransparentKeyHash> hash_function(filter.getSeed());
+    std::vector<uint64_t> hash_values(queries.size());
+    for (size_t q = 0; q < queries.size(); q++) {
+        hash_values[q] = hash_function.hash(queries[q]);
+    }
+    std::unique_ptr<bool[]> results(new bool[queries.size()]);
+    size_t negatives = 0;
+    for (size_t q = 0; q < queries.size(); q++) {
+        negatives += !positive[q];
+    }
+
+    for (const char *op : {"lookup", "lookup_batch"}) {
+        std::vector<double> samples;
+        size_t false_positives = 0;
+        uint64_t elapsed;
+        const bool batched = std::string(op) == "lookup_batch";
+        if (!batched) {
+            elapsed = timeBatches(0, queries.size(), samples, [&](size_t q) {
+                false_positives += filter.containsElement(queries[q]) && !positive[q];
+            });
+        } else {
+            elapsed = timeBatches(0, queries.size() / BENCH_BATCH_OPS, samples, [&](size_t b) {
+                filter.containsHashes(hash_values.data() + b * BENCH_BATCH_OPS, BENCH_BATCH_OPS,
+                                      results.get() + b * BENCH_BATCH_OPS);
+            });
+            for (double &sample : samples) {
+                sample /= BENCH_BATCH_OPS;
+            }
+            for (size_t q = 0; q < queries.size() / BENCH_BATCH_OPS * BENCH_BATCH_OPS; q++) {
+                false_positives += results[q] && !positive[q];
+            }
+        }
+        Record record;
+        record.add("filter", name)
+                .add("elements", elements)
+                .add("table_bytes", table_bytes)
+                .add("bits_per_key", elements ? table_bytes * 8.0 / elements : 0.0)
+                .add("build_ns_per_key", elements ? build_ns / (double) elements : 0.0)
+                .add("op", op)
+                .add("hit_ratio", hit_ratio)
+                .add("fpr", negatives ? false_positives / (double) negatives : 0.0);
+        addThroughput(record, batched ? queries.size() / BENCH_BATCH_OPS * BENCH_BATCH_OPS : queries.size(), elapsed,
+                      samples);
+        writer.write(record);
+    }
+}
+
+
+/**
+ * Comparing a cuckoo filter with static filters holding the same keys: frozen from the cuckoo filter, or
+ * built from the source keys, each with 8 and 16-bit fingerprints.
+ */
+template<size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
+void benchmarkFreeze(const std::string &layout, const BenchConfig &config, ResultWriter &writer) {
+    typedef CuckooFilter<uint64_t, entries_per_bucket, bits_per_fp, fp_type> Filter;
+
+    if (!config.layouts.empty() &&
+        std::find(config.layouts.begin(), config.layouts.end(), layout) == config.layouts.end()) {
+        return;
+    }
+
+    const size_t bytes_per_bucket = entries_per_bucket * bits_per_fp / 8;
+    const uint64_t negative_base = 1ULL << 62;
+
+    for (size_t table_bytes : config.table_bytes) {
+        for (double load : config.loads) {
+            Filter filter(table_bytes / bytes_per_bucket, STASH_DEFAULT_SIZE, config.seed);
+            const size_t target = (size_t) (load * filter.getTableSize() * entries_per_bucket);
+            std::vector<uint64_t> keys;
+            uint64_t begin = nowNs();
+            for (size_t k = 0; k < target; k++) {
+                if (!filter.insertElement(benchKey(k, config.seed))) {
+                    break;
+                }
+                keys.push_back(benchKey(k, config.seed));
+            }
+            uint64_t cuckoo_ns = nowNs() - begin;
+
+            begin = nowNs();
+            auto frozen8 = filter.template freeze<uint8_t>();
+            uint64_t frozen8_ns = nowNs() - begin;
+            begin = nowNs();
+            auto frozen16 = filter.template freeze<uint16_t>();
+            uint64_t frozen16_ns = nowNs() - begin;
+            begin = nowNs();
+            StaticFilter<uint64_t, uint8_t> static8(keys, config.seed);
+            uint64_t static8_ns = nowNs() - begin;
+            begin = nowNs();
+            StaticFilter<uint64_t, uint16_t> static16(keys, config.seed);
+            uint64_t static16_ns = nowNs() - begin;
+
+            for (double hit_ratio : config.hit_ratios) {
+                std::vector<uint64_t> queries(config.lookups);
+                std::vector<uint8_t> positive(config.lookups);
+                std::mt19937_64 rng(config.seed ^ (uint64_t) (hit_ratio * 1000));
+                std::uniform_real_distribution<double> coin(0, 1);
+                for (size_t q = 0; q < config.lookups; q++) {
+                    positive[q] = !keys.empty() && coin(rng) < hit_ratio;
+                    queries[q] = positive[q] ? keys[rng() % keys.size()] : benchKey(negative_base + q, config.seed);
+                }
+
+                const size_t n = keys.size();
+                freezeRecords(layout, filter, filter.getTableSize() * bytes_per_bucket, n, cuckoo_ns, queries,
+                              positive, hit_ratio, writer);
+                freezeRecords("frozen8", frozen8, frozen8.getTableBytes(), n, frozen8_ns, queries, positive,
+                              hit_ratio, writer);
+                freezeRecords("frozen16", frozen16, frozen16.getTableBytes(), n, frozen16_ns, queries, positive,
+                              hit_ratio, writer);
+                freezeRecords("static8", static8, static8.getTableBytes(), n, static8_ns, queries, positive,
+                              hit_ratio, writer);
+                freezeRecords("static16", static16, static16.getTableBytes(), n, static16_ns, queries, positive,
+                              hit_ratio, writer);
+            }
+        }
+    }
+}
+
+
+Record mapRecord(const std::string &name, size_t bytes, size_t elements, double target_load, const std::string &op) {
+    Record record;
+    record.add("map", name)
+            .add("elements", elements)
+            .add("bytes", bytes)
+            .add("bytes_per_key", elements ? bytes / (double) elements : 0.0)
+            .add("target_load", target_load)
+            .add("op", op);
+    return record;
+}
+
+
+/**
+ * Lookups of a key-value map for every thread count, each thread queries its share of the keys.
+ *
+ * @param bytes Memory used by the map
+ * @param find Functor looking up a key, returning true if it is contained
+ */
+template<typename Find>
+void mapLookupRecords(const std::string &name, size_t bytes, size_t elements, double target_load,
+                      const std::vector<uint64_t> &queries, double hit_ratio, const BenchConfig &config,
+                      ResultWriter &writer, Find find) {
+    for (size_t threads : config.threads) {
+        std::vector<std::vector<double>> thread_samples(threads);
+        std::vector<size_t> hits(threads, 0);
+        std::vector<std::thread> workers;
+        const size_t per_thread = (queries.size() + threads - 1) / threads;
+
+        uint64_t begin = nowNs();
+        for (size_t t = 0; t < threads; t++) {
+            workers.emplace_back([&, t]() {
+                size_t from = std::min(queries.size(), t * per_thread);
+                size_t to = std::min(queries.size(), from + per_thread);
+                timeBatches(from, to, thread_samples[t], [&](size_t q) {
+                    hits[t] += find(queries[q]);
+                });
+            });
+        }
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+        uint64_t elapsed = nowNs() - begin;
+
+        std::vector<double> samples;
+        size_t hit_total = 0;
+        for (size_t t = 0; t < threads; t++) {
+            hit_total += hits[t];
+            samples.insert(samples.end(), thread_samples[t].begin(), thread_samples[t].end());
+        }
+        Record record = mapRecord(name, bytes, elements, target_load, "find");
+        record.add("threads", threads)
+                .add("hit_ratio", hit_ratio)
+                .add("found", queries.empty() ? 0.0 : hit_total / (double) queries.size());
+        addThroughput(record, queries.size(), elapsed, samples);
+        writer.write(record);
+    }
+}
+
+
+/**
+ * Comparing CuckooMap with std::unordered_map holding the same 64-bit keys and values: insertion, lookups
+ * for each hit ratio and thread count, and erasure. The unordered map is sized by its own reservation, its
+ * memory is estimated from node and bucket array sizes.
+ */
+void benchmarkMap(const BenchConfig &config, ResultWriter &writer) {
+    typedef CuckooMap<uint64_t, uint64_t> Map;
+    const uint64_t negative_base = 1ULL << 62;
+
+    for (size_t table_bytes : config.table_bytes) {
+        for (double load : config.loads) {
+            Map map(table_bytes / MAP_BUCKET_BYTES, STASH_DEFAULT_SIZE, config.seed);
+            const size_t target = (size_t) (load * map.getTableSize() * Map::entries_per_bucket);
+            std::unordered_map<uint64_t, uint64_t> reference;
+
+            std::vector<double> map_samples;
+            size_t inserted = 0;
+            bool full = false;
+            uint64_t map_ns = timeBatches(0, target, map_samples, [&](size_t k) {
+                if (!full && map.insert(benchKey(k, config.seed), k) != InsertStatus::RejectedFull) {
+                    inserted++;
+                } else {
+                    full = true;
+                }
+            });
+            std::vector<double> reference_samples;
+            reference.reserve(inserted);
+            uint64_t reference_ns = timeBatches(0, inserted, reference_samples, [&](size_t k) {
+                reference.emplace(benchKey(k, config.seed), k);
+            });
+            const size_t map_bytes = map.getTableBytes();
+            // one heap node of key, value and next pointer per key, plus the bucket array
+            const size_t reference_bytes = inserted * (2 * sizeof(uint64_t) + sizeof(void *)) +
+                                           reference.bucket_count() * sizeof(void *);
+
+            const std::pair<const char *, size_t> maps[] = {{"cuckoo", map_bytes}, {"unordered", reference_bytes}};
+            for (const auto &entry : maps) {
+                const bool cuckoo = std::string(entry.first) == "cuckoo";
+                Record record = mapRecord(entry.first, entry.second, inserted, load, "insert");
+                record.add("threads", 1)
+                        .add("hit_ratio", "")
+                        .add("found", "");
+                addThroughput(record, inserted, cuckoo ? map_ns : reference_ns,
+                              cuckoo ? map_samples : reference_samples);
+                writer.write(record);
+            }
+
+            for (double hit_ratio : config.hit_ratios) {
+                std::vector<uint64_t> queries(config.lookups);
+                std::mt19937_64 rng(config.seed ^ (uint64_t) (hit_ratio * 1000));
+                std::uniform_real_distribution<double> coin(0, 1);
+                for (size_t q = 0; q < config.lookups; q++) {
+                    bool positive = inserted && coin(rng) < hit_ratio;
+                    queries[q] = positive ? benchKey(rng() % inserted, config.seed)
+                                          : benchKey(negative_base + q, config.seed);
+                }
+                mapLookupRecords("cuckoo", map_bytes, inserted, load, queries, hit_ratio, config, writer,
+                                 [&](uint64_t key) {
+                                     uint64_t value;
+                                     return map.find(key, value);
+                                 });
+                mapLookupRecords("unordered", reference_bytes, inserted, load, queries, hit_ratio, config, writer,
+                                 [&](uint64_t key) {
+                                     return reference.find(key) != reference.end();
+                                 });
+            }
+
+            map_samples.clear();
+            map_ns = timeBatches(0, inserted, map_samples, [&](size_t k) {
+                map.erase(benchKey(k, config.seed));
+            });
+            reference_samples.clear();
+            reference_ns = timeBatches(0, inserted, reference_samples, [&](size_t k) {
+                reference.erase(benchKey(k, config.seed));
+            });
+            for (const auto &entry : maps) {
+                const bool cuckoo = std::string(entry.first) == "cuckoo";
+                Record record = mapRecord(entry.first, entry.second, inserted, load, "erase");
+                record.add("threads", 1)
+                        .add("hit_ratio", "")
+                        .add("found", "");
+                addThroughput(record, inserted, cuckoo ? map_ns : reference_ns,
+                              cuckoo ? map_samples : reference_samples);
+                writer.write(record);
+            }
+        }
+    }
+}
+
+
+/**
+ * Routing lookups to one of PAYLOAD_TIERS storage tiers: one payload filter returning the tier of a key,
+ * against one cuckoo filter per tier probed in turn until one of them contains the key. Both use 16-bit
+ * entries and the same memory, the payload filter gives 2 bits of every entry to the tier.
+ */
+void benchmarkPayload(const BenchConfig &config, ResultWriter &writer) {
+    typedef PayloadFilter<uint64_t, 4, 16, uint16_t, 2> Routing;
+    typedef CuckooFilter<uint64_t, 4, 16, uint16_t> Tier;
+    const uint64_t negative_base = 1ULL << 62;
+
+    for (size_t table_bytes : config.table_bytes) {
+        for (double load : config.loads) {
+            Routing routing(table_bytes / 8, STASH_DEFAULT_SIZE, config.seed);
+            std::vector<std::unique_ptr<Tier>> tiers;
+            for (size_t t = 0; t < PAYLOAD_TIERS; t++) {
+                tiers.emplace_back(new Tier(table_bytes / 8 / PAYLOAD_TIERS, STASH_DEFAULT_SIZE, config.seed + t));
+            }
+            const size_t target = (size_t) (load * routing.getTableSize() * 4);
+            size_t inserted = 0;
+            while (inserted < target) {
+                const uint64_t key = benchKey(inserted, config.seed);
+                const uint32_t tier = inserted % PAYLOAD_TIERS;
+                if (!routing.insertElement(key, tier) || !tiers[tier]->insertElement(key)) {
+                    break;
+                }
+                inserted++;
+            }
+
+            for (double hit_ratio : config.hit_ratios) {
+                std::vector<uint64_t> queries(config.lookups);
+                std::vector<int> expected(config.lookups);
+                std::mt19937_64 rng(config.seed ^ (uint64_t) (hit_ratio * 1000));
+                std::uniform_real_distribution<double> coin(0, 1);
+                size_t positives = 0;
+                for (size_t q = 0; q < config.lookups; q++) {
+                    if (inserted && coin(rng) < hit_ratio) {
+                        size_t k = rng() % inserted;
+                        queries[q] = benchKey(k, config.seed);
+                        expected[q] = k % PAYLOAD_TIERS;
+                        positives++;
+                    } else {
+                        queries[q] = benchKey(negative_base + q, config.seed);
+                        expected[q] = -1;
+                    }
+                }
+
+                for (const char *scheme : {"payload", "per_tier"}) {
+                    const bool payload = std::string(scheme) == "payload";
+                    std::vector<int> routed(config.lookups);
+                    std::vector<double> samples;
+                    uint64_t elapsed = timeBatches(0, config.lookups, samples, [&](size_t q) {
+                        int tier = -1;
+                        uint32_t value;
+                        if (payload) {
+                            tier = routing.lookupValue(queries[q], value) ? (int) value : -1;
+                        } else {
+                            for (size_t t = 0; t < PAYLOAD_TIERS && tier < 0; t++) {
+                                tier = tiers[t]->containsElement(queries[q]) ? (int) t : -1;
+                            }
+                        }
+                        routed[q] = tier;
+                    });
+
+                    size_t misrouted = 0;
+                    size_t false_positives = 0;
+                    for (size_t q = 0; q < config.lookups; q++) {
+                        misrouted += expected[q] >= 0 && routed[q] != expected[q];
+                        false_positives += expected[q] < 0 && routed[q] >= 0;
+                    }
+                    const size_t bytes = payload ? routing.getTableBytes()
+                                                 : PAYLOAD_TIERS * tiers[0]->getTableSize() * 4 * 2;
+                    const size_t negatives = config.lookups - positives;
+                    Record record;
+                    record.add("scheme", scheme)
+                            .add("tiers", PAYLOAD_TIERS)
+                            .add("elements", inserted)
+                            .add("table_bytes", bytes)
+                            .add("bits_per_key", inserted ? bytes * 8.0 / inserted : 0.0)
+                            .add("target_load", load)
+                            .add("op", "route")
+                            .add("hit_ratio", hit_ratio)
+                            .add("misrouted", positives ? misrouted / (double) positives : 0.0)
+                            .add("fpr", negatives ? false_positives / (double) negatives : 0.0);
+                    addThroughput(record, config.lookups, elapsed, samples);
+                    writer.write(record);
+                }
+            }
+        }
+    }
+}
+
+
+/**
+ * Filling a small windowed filter until its stash is full and advancing until the tag of the stashed
+ * generation is reused. Stashed entries which expired must be gone by then, every key still contained is a
+ * revived one, apart from false positives.
+ *
+ * @return Number of contained keys of the expired generation
+ */
+size_t windowStashRevivals(uint64_t seed) {
+    typedef WindowedFilter<uint64_t, 4, 16, uint16_t, 2> Window;
+    Window window(1024, STASH_MAX_SIZE, seed);
+
+    size_t inserted = 0;
+    while (window.getStashSize() < STASH_MAX_SIZE &&
+           window.tryInsertElement(benchKey(inserted, seed)) != InsertStatus::RejectedFull) {
+        inserted++;
+    }
+    // the last advance reuses the tag of the inserted generation
+    for (size_t g = 0; g <= Window::live_generations; g++) {
+        window.advance();
+    }
+    size_t revived = 0;
+    for (size_t k = 0; k < inserted; k++) {
+        revived += window.containsElement(benchKey(k, seed));
+    }
+    return revived;
+}
+
+
+/**
+ * Streaming keys through a sliding window of 2 generation periods: a windowed filter with 2 generation bits
+ * advanced every period, against a cuckoo filter rebuilt every period from the keys of the last 2 periods.
+ * Both use 16-bit entries and the same memory. Insertion latency percentiles include the advance or the
+ * rebuild, false negatives are counted over the window after every period. Expiry of stashed entries
+ * across advance is checked once.
+ *
+ * @param failed Set to true if keys inside the window are missing or expired stashed keys are revived
+ */
+void benchmarkWindow(const BenchConfig &config, ResultWriter &writer, bool &failed) {
+    typedef WindowedFilter<uint64_t, 4, 16, uint16_t, 2> Window;
+    typedef CuckooFilter<uint64_t, 4, 16, uint16_t> Rebuilt;
+    const size_t window_periods = Window::live_generations - 1;
+    const uint64_t negative_base = 1ULL << 62;
+
+    const size_t revived = windowStashRevivals(config.seed);
+    Record expiry;
+    expiry.add("scheme", "windowed")
+            .add("op", "stash_expiry")
+            .add("revived", revived);
+    writer.write(expiry);
+    // 4096 keys at 14 fingerprint bits give less than one false positive on average
+    failed |= revived > 2;
+
+    for (size_t table_bytes : config.table_bytes) {
+        for (double load : config.loads) {
+            for (const char *scheme : {"windowed", "rebuild"}) {
+                const bool windowed = std::string(scheme) == "windowed";
+                Window window(table_bytes / 8, STASH_DEFAULT_SIZE, config.seed);
+                std::unique_ptr<Rebuilt> rebuilt(new Rebuilt(table_bytes / 8, STASH_DEFAULT_SIZE, config.seed));
+                // every live generation of the window is full at the target load
+                const size_t period = (size_t) (load * window.getTableSize() * 4 / Window::live_generations);
 
-    size_t numInserted = 0;
-    for (size_t i = from; i < to; i++, numInserted++) {
-        if (!filter->insertElement(i)) {
-            break;
+                std::vector<double> samples;
+                size_t rejected = 0;
+                size_t false_negatives = 0;
+                size_t checked = 0;
+                uint64_t elapsed = 0;
+                for (size_t p = 0; p < WINDOW_PERIODS; p++) {
+                    elapsed += timeBatches(p * period, (p + 1) * period, samples, [&](size_t k) {
+                        const uint64_t key = benchKey(k, config.seed);
+                        rejected += windowed ? !window.insertElement(key) : !rebuilt->insertElement(key);
+                    });
+
+                    // periods still inside the window once period p is closed
+                    const size_t from = p + 1 > window_periods ? (p + 1 - window_periods) * period : 0;
+                    for (size_t k = from; k < (p + 1) * period; k++) {
+                        const uint64_t key = benchKey(k, config.seed);
+                        false_negatives += windowed ? !window.containsElement(key) : !rebuilt->containsElement(key);
+                        checked++;
+                    }
+
+                    // closing the period is charged to the batch in which it happens
+                    uint64_t begin = nowNs();
+                    if (windowed) {
+                        window.advance();
+                    } else {
+                        rebuilt.reset(new Rebuilt(table_bytes / 8, STASH_DEFAULT_SIZE, config.seed));
+                        for (size_t k = from; k < (p + 1) * period; k++) {
+                            rebuilt->insertElement(benchKey(k, config.seed));
+                        }
+                    }
+                    uint64_t closing = nowNs() - begin;
+                    if (!samples.empty()) {
+                        samples.back() += closing / (double) BENCH_BATCH_OPS;
+                    }
+                    elapsed += closing;
+                }
+
+                size_t false_positives = 0;
+                for (size_t q = 0; q < config.lookups; q++) {
+                    const uint64_t key = benchKey(negative_base + q, config.seed);
+                    false_positives += windowed ? window.containsElement(key) : rebuilt->containsElement(key);
+                }
+
+                const size_t inserts = WINDOW_PERIODS * period;
+                const size_t bytes = windowed ? window.getTableBytes() : rebuilt->getTableSize() * 4 * 2;
+                Record record;
+                record.add("scheme", scheme)
+                        .add("table_bytes", bytes)
+                        .add("target_load", load)
+                        .add("period", period)
+                        .add("periods", WINDOW_PERIODS)
+                        .add("op", "insert")
+                        .add("rejected", rejected)
+                        .add("false_negatives", checked ? false_negatives / (double) checked : 0.0)
+                        .add("fpr", config.lookups ? false_positives / (double) config.lookups : 0.0);
+                addThroughput(record, inserts, elapsed, samples);
+                writer.write(record);
+                failed |= windowed && false_negatives > 0;
+            }
         }
     }
-    return numInserted;
 }
 
 
-template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
-void containsIntsInRange(CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type> *filter, size_t from,
-                         size_t to) {
-    for (size_t i = from; i < to; i++) {
-        assert(filter->containsElement(i));
+/**
+ * Combining two partition filters with disjoint keys, each filled to half of the target load: merging
+ * fingerprints by bucket position, sequentially and with the largest configured thread count, against
+ * reinserting the keys of the second partition, which needs the keys.
+ */
+void benchmarkMerge(const BenchConfig &config, ResultWriter &writer) {
+    typedef CuckooFilter<uint64_t, 4, 16, uint16_t> Partition;
+    const size_t threads = *std::max_element(config.threads.begin(), config.threads.end());
+
+    for (size_t table_bytes : config.table_bytes) {
+        for (double load : config.loads) {
+            for (const char *scheme : {"merge", "merge_parallel", "reinsert"}) {
+                Partition merged(table_bytes / 8, STASH_DEFAULT_SIZE, config.seed);
+                Partition other(table_bytes / 8, STASH_DEFAULT_SIZE, config.seed);
+                const size_t half = (size_t) (load * merged.getTableSize() * 4 / 2);
+                for (size_t k = 0; k < half; k++) {
+                    merged.insertElement(benchKey(k, config.seed));
+                    other.insertElement(benchKey(half + k, config.seed));
+                }
+                const double estimated = merged.estimateMerge(other).load_factor;
+
+                bool complete = true;
+                uint64_t begin = nowNs();
+                if (std::string(scheme) == "merge") {
+                    complete = merged.merge(other);
+                } else if (std::string(scheme) == "merge_parallel") {
+                    complete = merged.mergeParallel(other, threads);
+                } else {
+                    for (size_t k = half; k < 2 * half; k++) {
+                        complete &= merged.insertElement(benchKey(k, config.seed));
+                    }
+                }
+                uint64_t elapsed = nowNs() - begin;
+
+                size_t false_negatives = 0;
+                for (size_t k = 0; k < 2 * half; k++) {
+                    false_negatives += !merged.containsElement(benchKey(k, config.seed));
+                }
+                std::vector<double> samples = {half ? elapsed / (double) half : 0.0};
+                Record record;
+                record.add("scheme", scheme)
+                        .add("threads", std::string(scheme) == "merge_parallel" ? threads : 1)
+                        .add("table_bytes", merged.getTableSize() * 4 * 2)
+                        .add("target_load", load)
+                        .add("estimated_load", estimated)
+                        .add("load", merged.getLoadFactor())
+                        .add("op", "merge")
+                        .add("complete", complete ? 1 : 0)
+                        .add("false_negatives", false_negatives);
+                addThroughput(record, half, elapsed, samples);
+                writer.write(record);
+            }
+        }
     }
 }
 
-template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
-float getFPRate(CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type> *filter, size_t from, size_t to) {
-    size_t total_queries = 0;
-    size_t false_queries = 0;
-    for (size_t i = from; i < to; i++) {
-        if (filter->containsElement(i)) {
-            false_queries++;
+
+/**
+ * Keeping a replica in sync with deltas shipped through a shared directory: the primary saves a snapshot of a
+ * filter filled to the target load, then replaces a fraction of the stored elements and saves the resulting
+ * delta, and the replica catches up from the directory after each save. Reports the delta size against
+ * shipping the whole table.
+ *
+ * @param failed Set if the replica could not catch up or answers differently than the primary
+ */
+void benchmarkDelta(const BenchConfig &config, ResultWriter &writer, bool &failed) {
+    typedef CuckooFilter<uint64_t, 4, 16, uint16_t> Replicated;
+
+    for (size_t table_bytes : config.table_bytes) {
+        for (double load : config.loads) {
+            for (double churn : {0.0001, 0.001, 0.01, 0.1}) {
+                char directory[] = "/tmp/cuckoo-delta-XXXXXX";
+                if (!mkdtemp(directory)) {
+                    std::cerr << "Cannot create delta directory" << std::endl;
+                    failed = true;
+                    return;
+                }
+                Replicated primary(table_bytes / 8, STASH_DEFAULT_SIZE, config.seed);
+                Replicated replica(table_bytes / 8, STASH_DEFAULT_SIZE, config.seed);
+                const size_t stored = (size_t) (load * primary.getTableSize() * 4);
+                for (size_t k = 0; k < stored; k++) {
+                    primary.insertElement(benchKey(k, config.seed));
+                }
+                saveDelta(primary.extractDelta(true), directory);
+                size_t caught_up = catchUp(replica, directory);
+
+                const size_t replaced = std::max((size_t) 1, (size_t) (churn * stored));
+                for (size_t k = 0; k < replaced; k++) {
+                    primary.deleteElement(benchKey(k, config.seed));
+                    primary.insertElement(benchKey(stored + k, config.seed));
+                }
+                uint64_t begin = nowNs();
+                FilterDelta delta = primary.extractDelta();
+                uint64_t extracted = nowNs() - begin;
+                begin = nowNs();
+                saveDelta(delta, directory);
+                uint64_t saved = nowNs() - begin;
+                // loading from the directory and applying
+                begin = nowNs();
+                caught_up += catchUp(replica, directory);
+                uint64_t elapsed = nowNs() - begin;
+                const bool applied = caught_up == 2 && replica.getSequence() == primary.getSequence();
+
+                size_t mismatches = 0;
+                for (size_t k = 0; k < stored + replaced; k++) {
+                    const uint64_t key = benchKey(k, config.seed);
+                    mismatches += primary.containsElement(key) != replica.containsElement(key);
+                }
+                failed |= !applied || mismatches > 0;
+
+                for (uint64_t sequence = 1; sequence <= primary.getSequence(); sequence++) {
+                    remove(deltaPath(directory, sequence).c_str());
+                }
+                rmdir(directory);
+
+                const size_t bytes = primary.getTableSize() * 4 * 2;
+                std::vector<double> samples = {elapsed / (double) std::max((size_t) 1, delta.ranges.size())};
+                Record record;
+                record.add("table_bytes", bytes)
+                        .add("target_load", load)
+                        .add("churn", churn)
+                        .add("replaced", replaced)
+                        .add("op", "catch_up_range")
+                        .add("ranges", delta.ranges.size())
+                        .add("delta_bytes", delta.data.size())
+                        .add("delta_ratio", delta.data.size() / (double) bytes)
+                        .add("extract_ns", extracted)
+                        .add("save_ns", saved)
+                        .add("applied", applied ? 1 : 0)
+                        .add("mismatches", mismatches);
+                addThroughput(record, delta.ranges.size(), elapsed, samples);
+                writer.write(record);
+            }
         }
-        total_queries++;
     }
-    return 100.0 * false_queries / total_queries;
 }
 
-template<typename element_type, size_t entries_per_bucket, size_t bits_per_fp, typename fp_type>
-void
-deleteAllInRange(CuckooFilter<element_type, entries_per_bucket, bits_per_fp, fp_type> *filter, size_t from, size_t to) {
-    for (size_t i = from; i < to; i++) {
-        filter->deleteElement(i);
+
+template<typename hasher_type, typename key_type>
+double hashingTime(const std::vector<key_type> &keys, uint64_t seed) {
+    HashFunction<hasher_type> hash_function(seed);
+    uint64_t sink = 0;
+
+    uint64_t begin = nowNs();
+    for (const key_type &key : keys) {
+        sink += hash_function.hash(key);
     }
+    uint64_t end = nowNs();
+
+    // keeps the loop from being optimized away
+    if (sink == 1) std::cout << "";
+    return (end - begin) / (double) keys.size();
+}
+
+template<typename hasher_type>
+double filterInsertionTime(size_t table_size, size_t num_elements, uint64_t seed) {
+    CuckooFilter<size_t, 4, 16, uint16_t, hasher_type> filter(table_size, STASH_DEFAULT_SIZE, seed);
+
+    uint64_t begin = nowNs();
+    for (size_t i = 0; i < num_elements; i++) {
+        filter.insertElement(i);
+    }
+    uint64_t end = nowNs();
+    return (end - begin) / (double) num_elements;
+}
+
+/**
+ * Comparing the cost of the keyed SipHash-1-3 hasher with the default unkeyed fast path.
+ */
+void benchmarkHashing(size_t n, uint64_t seed, ResultWriter &writer) {
+    std::vector<size_t> ints(n);
+    std::vector<std::string> urls(n);
+    for (size_t i = 0; i < n; i++) {
+        ints[i] = i;
+        urls[i] = "https://example.com/item/" + std::to_string(i);
+    }
+
+    writer.write(Record().add("op", "hash_integer")
+                         .add("fast_ns", hashingTime<TransparentKeyHash>(ints, seed))
+                         .add("keyed_ns", hashingTime<SipKeyHash>(ints, seed)));
+    writer.write(Record().add("op", "hash_url")
+                         .add("fast_ns", hashingTime<TransparentKeyHash>(urls, seed))
+                         .add("keyed_ns", hashingTime<SipKeyHash>(urls, seed)));
+    writer.write(Record().add("op", "filter_insert")
+                         .add("fast_ns", filterInsertionTime<TransparentKeyHash>(n, n, seed))
+                         .add("keyed_ns", filterInsertionTime<SipKeyHash>(n, n, seed)));
+}
+
+
+void usage(const char *program) {
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --mode filter|insert-tail|mixed|fpr|freeze|map|payload|window|merge|delta|hashing\n"
+              << "                          benchmark to run (filter)\n"
+              << "  --format csv|json       output format (csv)\n"
+              << "  --output PATH           output file (standard output)\n"
+              << "  --min-bytes SIZE        smallest table, K/M/G suffixes allowed (32K)\n"
+              << "  --max-bytes SIZE        largest table, sizes grow 8x (32M)\n"
+              << "  --loads LIST            target load factors (0.5,0.9,0.95)\n"
+              << "  --hit-ratios LIST       fraction of lookups for inserted keys (0,0.5,1)\n"
+              << "  --threads LIST          lookup thread counts (1,2,4)\n"
+              << "  --lookup-modes LIST     filter lookup modes, sequential or speculative (sequential,speculative)\n"
+              << "  --index-policies LIST   filter benchmark index schemes, xor, modular or vacuum (xor)\n"
+              << "  --depths LIST           lookups in flight of the interleaved lookup engine (4,16)\n"
+              << "  --lookups N             lookups per combination (1000000)\n"
+              << "  --layouts LIST          subset of 4x4,4x8,4x12,4x16,2x32, and morton in filter mode (all)\n"
+              << "  --load-edges LIST       load ranges of insert-tail percentiles\n"
+              << "                          (0.5,0.7,0.8,0.85,0.9,0.92,0.94,0.95,0.96,0.97,0.98,0.99,1)\n"
+              << "  --mixes LIST            mixed workloads, lookup/insert/delete percentages (90/9/1,50/25/25)\n"
+              << "  --distributions LIST    mixed workload key popularity, uniform or zipf (uniform,zipf)\n"
+              << "  --zipf-theta X          zipfian skew (0.99)\n"
+              << "  --duration-ms N         duration of each mixed workload run (1000)\n"
+              << "  --query-sets LIST       false positive rate queries (random,sequential,bitflip,adversarial)\n"
+              << "  --confidence X          confidence level of false positive rate intervals (0.95)\n"
+              << "  --perf on|off           hardware counters per operation, Linux only (off)\n"
+              << "  --seed N                hash seed and key salt (1)\n";
 }
 
 
 int main(int argc, char **argv) {
-    size_t tableSize = 10000;
-//    size_t tableSize = 32768;
-
-    //Elements inserted in the filter are from 0 to numOfElements
-    size_t numOfElements = tableSize;
-//    size_t numOfElements = 32768;
-
-    int n = 1;
-
-    static const size_t fs = 16;
-
-    double totalTime = 0.;
-    double insTotalTime = 0.;
-    double contTotalTime = 0.;
-    double delTotalTime = 0.;
-
-    size_t from = 0;
-    size_t to = numOfElements;
-
-    size_t numInserted;
-    float numInsertedTot = 0;
-
-    float fpRate;
-    float fpRateTot = 0;
-
-    double availabilityTot = 0.;
-
-    for (size_t i = 0; i < n; ++i) {
-        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
-
-        CuckooFilter<size_t, 4, fs, uint16_t> filter(tableSize);
-        std::cout << "Filter size: " << sizeof(filter) << std::endl;
-
-        std::chrono::steady_clock::time_point insBegin = std::chrono::steady_clock::now();
-        numInserted = insertIntsInRange(&filter, from, to);
-        std::chrono::steady_clock::time_point insEnd = std::chrono::steady_clock::now();
-        numInsertedTot += numInserted;
-        insTotalTime += std::chrono::duration_cast<std::chrono::microseconds>(insEnd - insBegin).count();
-
-        std::chrono::steady_clock::time_point containsBegin = std::chrono::steady_clock::now();
-        containsIntsInRange(&filter, from, numInserted);
-        std::chrono::steady_clock::time_point containsEnd = std::chrono::steady_clock::now();
-        contTotalTime += std::chrono::duration_cast<std::chrono::microseconds>(containsEnd - containsBegin).count();
-
-        fpRate = getFPRate(&filter, to, 2 * to);
-        fpRateTot += fpRate;
-//        double availability = filter.availability();
-//        availabilityTot += availability;
-
-        std::chrono::steady_clock::time_point delBegin = std::chrono::steady_clock::now();
-        deleteAllInRange(&filter, from, numInserted);
-        std::chrono::steady_clock::time_point delEnd = std::chrono::steady_clock::now();
-        delTotalTime += std::chrono::duration_cast<std::chrono::microseconds>(delEnd - delBegin).count();
-
-        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
-        totalTime += std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
-
-        std::cout << i << ". iter" << std::endl;
-        std::cout << "Inserted: " << numInserted << "/" << numOfElements << std::endl;
-        std::cout << "false positive rate is "
-                  << fpRate << "%\n";
-//        std::cout << "availability: "
-//                  << availability << "%\n";
-    }
-
-
-    std::ofstream myfile("/home/patrik/FAKS/3_SEM_DIPL/BIOINF/projekt_impl/CuckooFilter/Tests/CF_time-size.txt");
-    if (myfile.is_open()) {
-        myfile
-                << "# format -> '#' marks comment, 's' table size, 'fs' fingerprint size, 'ne' num of elements inserted to the table, 'n' num of iterations conducted in the test, 'u' unit of measurement,\n";
-        myfile
-                << "# 'ni' marks avg number of inserted elements, 'fp' the false positive rate and 'a' the avg percentage of free space in the table,\n";
-        myfile << "# 'i' marks avg insertion time, 'l' avg lookup time and 'd' avg deletion time\n";
-        myfile << "s " << tableSize << "\n";
-        myfile << "fs " << fs << "\n";
-        myfile << "ne " << numOfElements << "\n";
-        myfile << "n " << n << "\n";
-        myfile << "ni " << numInsertedTot / ((float) n) << "\n";
-        myfile << "fp " << fpRateTot / ((float) n) << "\n";
-        myfile << "a " << availabilityTot / ((float) n) << "\n";
-        myfile << "u [µs]" << "\n";
-        myfile << "i " << insTotalTime / n << "\n";
-        myfile << "l " << contTotalTime / n << "\n";
-        myfile << "d " << delTotalTime / n << "\n";
-        myfile.close();
-    }
-
-
-    std::cout << "\nAvg insertion time: " << insTotalTime / n
-              << "[µs] (for " << numInsertedTot / ((float) n) << " elements inserted in avg)" << std::endl;
-    std::cout << "Avg lookup time: " << contTotalTime / n
-              << "[µs] (for " << numInsertedTot / ((float) n) << " elements inserted in avg)" << std::endl;
-    std::cout << "Avg deletion time: " << delTotalTime / n
-              << "[µs] (for " << numInsertedTot / ((float) n) << " elements inserted in avg)" << std::endl;
-    std::cout << "Avg time (all operations): " << totalTime / n
-              << "[µs]" << std::endl;
-
-}
\ No newline at end of file
+    std::string mode = "filter";
+    std::string format = "csv";
+    std::string output;
+    size_t min_bytes = 32 << 10;
+    size_t max_bytes = 32 << 20;
+
+    BenchConfig config;
+    config.loads = {0.5, 0.9, 0.95};
+    config.hit_ratios = {0, 0.5, 1};
+    config.threads = {1, 2, 4};
+    config.depths = {4, 16};
+    config.index_policies = {"xor"};
+    config.lookup_modes = {"sequential", "speculative"};
+    config.lookups = 1000000;
+    config.seed = 1;
+    config.perf = false;
+    config.mixes = {"90/9/1", "50/25/25"};
+    config.distributions = {"uniform", "zipf"};
+    config.zipf_theta = 0.99;
+    config.duration_ms = 1000;
+    config.query_sets = {"random", "sequential", "bitflip", "adversarial"};
+    config.confidence = 0.95;
+    config.load_edges = {0.5, 0.7, 0.8, 0.85, 0.9, 0.92, 0.94, 0.95, 0.96, 0.97, 0.98, 0.99, 1};
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || i + 1 >= argc) {
+            usage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--mode") {
+            mode = value;
+        } else if (arg == "--format") {
+            format = value;
+        } else if (arg == "--output") {
+            output = value;
+        } else if (arg == "--min-bytes") {
+            min_bytes = parseBytes(value);
+        } else if (arg == "--max-bytes") {
+            max_bytes = parseBytes(value);
+        } else if (arg == "--loads") {
+            config.loads = parseList<double>(value);
+        } else if (arg == "--hit-ratios") {
+            config.hit_ratios = parseList<double>(value);
+        } else if (arg == "--threads") {
+            config.threads = parseList<size_t>(value);
+        } else if (arg == "--lookup-modes") {
+            config.lookup_modes = splitList(value);
+        } else if (arg == "--index-policies") {
+            config.index_policies = splitList(value);
+        } else if (arg == "--depths") {
+            config.depths = parseList<size_t>(value);
+        } else if (arg == "--lookups") {
+            config.lookups = strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--layouts") {
+            config.layouts = splitList(value);
+        } else if (arg == "--mixes") {
+            config.mixes = splitList(value);
+        } else if (arg == "--distributions") {
+            config.distributions = splitList(value);
+        } else if (arg == "--zipf-theta") {
+            config.zipf_theta = strtod(value.c_str(), nullptr);
+        } else if (arg == "--duration-ms") {
+            config.duration_ms = strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--query-sets") {
+            config.query_sets = splitList(value);
+        } else if (arg == "--confidence") {
+            config.confidence = strtod(value.c_str(), nullptr);
+        } else if (arg == "--load-edges") {
+            config.load_edges = parseList<double>(value);
+        } else if (arg == "--perf") {
+            config.perf = value == "on";
+        } else if (arg == "--seed") {
+            config.seed = strtoull(value.c_str(), nullptr, 10);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    for (size_t bytes = min_bytes; bytes <= max_bytes; bytes *= 8) {
+        config.table_bytes.push_back(bytes);
+    }
+
+    std::ofstream file;
+    if (!output.empty()) {
+        file.open(output);
+        if (!file.is_open()) {
+            std::cerr << "Can not open " << output << std::endl;
+            return 1;
+        }
+    }
+    if (config.perf && !PerfCounters().available()) {
+        std::cerr << "Hardware counters are not available, check /proc/sys/kernel/perf_event_paranoid"
+                  << std::endl;
+    }
+    ResultWriter writer(output.empty() ? std::cout : file, format == "json");
+
+    if (mode == "hashing") {
+        benchmarkHashing(config.lookups, config.seed, writer);
+    } else if (mode == "insert-tail") {
+        benchmarkInsertTail<4, 4, uint8_t>("4x4", config, writer);
+        benchmarkInsertTail<4, 8, uint8_t>("4x8", config, writer);
+        benchmarkInsertTail<4, 12, uint16_t>("4x12", config, writer);
+        benchmarkInsertTail<4, 16, uint16_t>("4x16", config, writer);
+        benchmarkInsertTail<2, 32, uint32_t>("2x32", config, writer);
+    } else if (mode == "mixed") {
+        bool failed = false;
+        benchmarkMixed<4, 4, uint8_t>("4x4", config, writer, failed);
+        benchmarkMixed<4, 8, uint8_t>("4x8", config, writer, failed);
+        benchmarkMixed<4, 12, uint16_t>("4x12", config, writer, failed);
+        benchmarkMixed<4, 16, uint16_t>("4x16", config, writer, failed);
+        benchmarkMixed<2, 32, uint32_t>("2x32", config, writer, failed);
+        if (failed) {
+            std::cerr << "Mixed workload failed: false negatives for present keys or invalid mix" << std::endl;
+            return 2;
+        }
+    } else if (mode == "fpr") {
+        benchmarkFpr<4, 4, uint8_t>("4x4", config, writer);
+        benchmarkFpr<4, 8, uint8_t>("4x8", config, writer);
+        benchmarkFpr<4, 12, uint16_t>("4x12", config, writer);
+        benchmarkFpr<4, 16, uint16_t>("4x16", config, writer);
+        benchmarkFpr<2, 32, uint32_t>("2x32", config, writer);
+    } else if (mode == "freeze") {
+        benchmarkFreeze<4, 8, uint8_t>("4x8", config, writer);
+        benchmarkFreeze<4, 12, uint16_t>("4x12", config, writer);
+        benchmarkFreeze<4, 16, uint16_t>("4x16", config, writer);
+    } else if (mode == "map") {
+        benchmarkMap(config, writer);
+    } else if (mode == "payload") {
+        benchmarkPayload(config, writer);
+    } else if (mode == "window") {
+        bool failed = false;
+        benchmarkWindow(config, writer, failed);
+        if (failed) {
+            std::cerr << "Window failed: false negatives inside the window or revived expired keys" << std::endl;
+            return 2;
+        }
+    } else if (mode == "merge") {
+        benchmarkMerge(config, writer);
+    } else if (mode == "delta") {
+        bool failed = false;
+        benchmarkDelta(config, writer, failed);
+        if (failed) {
+            std::cerr << "Delta failed: replica did not catch up or differs from the primary" << std::endl;
+            return 2;
+        }
+    } else if (mode == "filter") {
+        for (const std::string &policy : config.index_policies) {
+            if (policy == "xor") {
+                benchmarkLayouts<XorIndexPolicy>(config, writer);
+            } else if (policy == "modular") {
+                benchmarkLayouts<ModularIndexPolicy>(config, writer);
+            } else if (policy == "vacuum") {
+                benchmarkLayouts<VacuumIndexPolicy>(config, writer);
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+    } else {
+        usage(argv[0]);
+        return 1;
+    }
+    return 0;
+}
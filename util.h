@@ -1,3 +1,6 @@
+#ifndef CUCKOOFILTER_UTIL_H
+#define CUCKOOFILTER_UTIL_H
+
 #include <stdint.h>
 #include <stdlib.h>
 
@@ -6,14 +9,17 @@ struct Victim {
     size_t index = 0;
 };
 
+/**
+ * @param v Value
+ * @return Largest power of two not above v, 0 for 0
+ */
 static const size_t highestPowerOfTwo(uint32_t v) {
-    v--;
     v |= v >> 1;
     v |= v >> 2;
     v |= v >> 4;
     v |= v >> 8;
     v |= v >> 16;
-    v++;
-    v >>= 1;
-    return v;
-}
\ No newline at end of file
+    return v - (v >> 1);
+}
+
+#endif
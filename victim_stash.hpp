@@ -0,0 +1,202 @@
+#ifndef CUCKOOFILTER_VICTIM_STASH_H
+#define CUCKOOFILTER_VICTIM_STASH_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "util.h"
+
+#define STASH_DEFAULT_SIZE 4
+#define STASH_MAX_SIZE 64
+
+
+/**
+ * Small fixed-capacity cache for fingerprints whose kick chain failed. Fingerprints and bucket indices
+ * are kept in separate dense arrays, so a lookup is a single branch-free pass which the compiler can
+ * vectorize. Free entries are never scanned, stored entries are kept packed at the front.
+ */
+class VictimStash {
+
+private:
+    // fingerprints of stashed elements, 0 marks a free entry
+    uint32_t fps_[STASH_MAX_SIZE];
+
+    // bucket index the fingerprint was being inserted in
+    uint32_t indices_[STASH_MAX_SIZE];
+
+    // maximum number of stashed elements
+    size_t capacity_;
+
+    // number of stashed elements
+    size_t size_;
+
+public:
+
+    /**
+     * Constructing empty stash with given capacity.
+     *
+     * @param capacity Maximum number of stashed elements, at most STASH_MAX_SIZE
+     */
+    explicit VictimStash(size_t capacity);
+
+    /**
+     * @return Number of stashed elements
+     */
+    size_t size() const;
+
+    /**
+     * @return Maximum number of stashed elements
+     */
+    size_t capacity() const;
+
+    /**
+     * @return True if there are no stashed elements
+     */
+    bool empty() const;
+
+    /**
+     * @return True if no more elements can be stashed
+     */
+    bool full() const;
+
+    /**
+     * Stashing fingerprint fp which belongs to bucket index.
+     *
+     * @param fp Fingerprint
+     * @param index One of the two candidate buckets of the fingerprint
+     * @return False if stash is full
+     */
+    bool push(uint32_t fp, size_t index);
+
+    /**
+     * Checking if fingerprint fp with candidate buckets i1 and i2 is stashed.
+     *
+     * @param fp Fingerprint
+     * @param i1 Primary index
+     * @param i2 Secondary index
+     * @return True if fingerprint is stashed
+     */
+    bool contains(uint32_t fp, size_t i1, size_t i2) const;
+
+    /**
+     * Removing one occurrence of fingerprint fp with candidate buckets i1 and i2.
+     *
+     * @param fp Fingerprint
+     * @param i1 Primary index
+     * @param i2 Secondary index
+     * @return True if fingerprint was stashed and is removed
+     */
+    bool remove(uint32_t fp, size_t i1, size_t i2);
+
+    /**
+     * Gets stashed element on position k, k < size().
+     *
+     * @param k Position in stash
+     * @return Stashed element
+     */
+    Victim get(size_t k) const;
+
+    /**
+     * Removing stashed element on position k, k < size(). Last element is moved to position k.
+     *
+     * @param k Position in stash
+     */
+    void removeAt(size_t k);
+
+    /**
+     * Removing and returning most recently stashed element. Stash must not be empty.
+     *
+     * @return Removed element
+     */
+    Victim pop();
+};
+
+
+inline VictimStash::VictimStash(size_t capacity) {
+    this->capacity_ = capacity;
+    this->size_ = 0;
+    for (size_t k = 0; k < STASH_MAX_SIZE; k++) {
+        fps_[k] = 0;
+        indices_[k] = 0;
+    }
+}
+
+
+inline size_t VictimStash::size() const {
+    return size_;
+}
+
+
+inline size_t VictimStash::capacity() const {
+    return capacity_;
+}
+
+
+inline bool VictimStash::empty() const {
+    return size_ == 0;
+}
+
+
+inline bool VictimStash::full() const {
+    return size_ >= capacity_;
+}
+
+
+inline bool VictimStash::push(const uint32_t fp, const size_t index) {
+    if (full()) {
+        return false;
+    }
+    fps_[size_] = fp;
+    indices_[size_] = index;
+    size_++;
+    return true;
+}
+
+
+inline bool VictimStash::contains(const uint32_t fp, const size_t i1, const size_t i2) const {
+    const uint32_t a = i1;
+    const uint32_t b = i2;
+    bool found = false;
+    // no early exit, the loop is compiled to vector compares
+    for (size_t k = 0; k < size_; k++) {
+        found |= (fps_[k] == fp) & ((indices_[k] == a) | (indices_[k] == b));
+    }
+    return found;
+}
+
+
+inline bool VictimStash::remove(const uint32_t fp, const size_t i1, const size_t i2) {
+    for (size_t k = 0; k < size_; k++) {
+        if (fps_[k] == fp && (indices_[k] == i1 || indices_[k] == i2)) {
+            removeAt(k);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+inline Victim VictimStash::get(const size_t k) const {
+    Victim victim;
+    victim.fp = fps_[k];
+    victim.index = indices_[k];
+    return victim;
+}
+
+
+inline void VictimStash::removeAt(const size_t k) {
+    size_--;
+    fps_[k] = fps_[size_];
+    indices_[k] = indices_[size_];
+    fps_[size_] = 0;
+    indices_[size_] = 0;
+}
+
+
+inline Victim VictimStash::pop() {
+    Victim victim = get(size_ - 1);
+    removeAt(size_ - 1);
+    return victim;
+}
+
+#endif
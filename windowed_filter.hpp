@@ -0,0 +1,665 @@
+#ifndef CUCKOOFILTER_WINDOWED_FILTER_H
+#define CUCKOOFILTER_WINDOWED_FILTER_H
+
+#include <stdexcept>
+#include <string>
+#include "payload_filter.hpp"
+
+// buckets swept for expired entries by every insertion, spreads reclamation over the generation
+#define WINDOW_SWEEP_STEP 2
+
+
+/**
+ * Cuckoo filter over a sliding window of time, for deduplication windows like "the last 10 minutes".
+ * Every entry carries the generation it was inserted in, in generation_bits value bits of PayloadCodec,
+ * and the caller closes a generation by calling advance, e.g. from a timer. 2^generation_bits - 1
+ * generations are live, the current one included, and entries of the oldest generation expire when the
+ * next one starts. An element is therefore contained for between live_generations - 1 and
+ * live_generations generation periods after its insertion, with 2 generation bits and advance called
+ * every 5 minutes it is contained for 10 to 15 minutes.
+ *
+ * Expired entries are recognized by their tag alone, the original keys are not needed. They are ignored
+ * by lookups at once and reclaimed lazily: insertions clear expired entries of every bucket they touch
+ * and sweep WINDOW_SWEEP_STEP further buckets, and sweep reclaims a given number of buckets, e.g. from an
+ * idle loop. advance finishes the sweep of the expiring generation before its tag is reused, so the more
+ * was swept in between, the less work is left for advance.
+ *
+ * @tparam element_type Working element type
+ * @tparam entries_per_bucket Number of entries in bucket
+ * @tparam bits_per_slot Number of bits of an entry, fingerprint and generation together
+ * @tparam slot_type Entry type of the table
+ * @tparam generation_bits Number of generation bits of an entry, 2 to 8
+ * @tparam hasher_type Functor mapping keys to 64-bit hash values, see KeyHash
+ * @tparam index_policy Mapping of hash values and fingerprints to buckets
+ *
+ * Compiled with -DCUCKOO_FILTER_STATS, every operation updates per-thread FilterStats counters,
+ * aggregated by StatsRegistry::instance().collect().
+ */
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type = TransparentKeyHash, typename index_policy = XorIndexPolicy>
+class WindowedFilter {
+
+    static_assert(generation_bits >= 2, "A window needs at least 2 generation bits");
+
+public:
+    typedef PayloadCodec<bits_per_slot, generation_bits> codec;
+
+    // number of generations whose entries are contained, one tag value is always expiring
+    static const size_t live_generations = (1U << generation_bits) - 1;
+
+private:
+    // table storing entries tagged with generations, its fingerprint mask covers the whole entry
+    CuckooTable<entries_per_bucket, bits_per_slot, slot_type> *table_;
+
+    // maps hash values and fingerprints to buckets
+    index_policy index_policy_;
+
+    // number of stored entries, expired entries which are not reclaimed yet included
+    size_t element_count_;
+
+    // used for calculating hash values
+    HashFunction<hasher_type> *hash_function_;
+
+    // tagged entries whose kick chain failed
+    VictimStash stash_;
+
+    // tag of entries inserted now
+    uint32_t generation_;
+
+    // tag of expired entries, the one following generation_ modulo 2^generation_bits
+    uint32_t expired_;
+
+    // next bucket to be swept, table size once the expiring generation is reclaimed from the whole table
+    size_t sweep_cursor_;
+
+    /**
+     * Method for calculating primary index and fingerprint from element hash value.
+     *
+     * @param hash_value 64-bit hash value of the element
+     * @param fp Fingerprint pointer
+     * @param index Index pointer
+     */
+    inline void firstPass(uint64_t hash_value, uint32_t *fp, size_t *index) const;
+
+    /**
+     * @param index Previously calculated index
+     * @param entry Tagged entry
+     * @return Secondary index calculated from fingerprint of entry and previous index
+     */
+    inline size_t indexComplement(size_t index, uint32_t entry) const;
+
+    /**
+     * Finding live entry with fingerprint fp in buckets i1 and i2 or in the stash.
+     *
+     * @param entry Set to the matching entry
+     * @param index Set to index of bucket holding the entry, or stash position if it is stashed
+     * @param stashed Set to true if the entry is stashed
+     * @return True if a live entry is found
+     */
+    bool find(uint32_t fp, size_t i1, size_t i2, uint32_t &entry, size_t &index, bool &stashed) const;
+
+    /**
+     * Clearing expired entries of bucket i, stashed entries move into freed slots.
+     *
+     * @return Number of cleared entries
+     */
+    size_t reclaim(size_t i);
+
+    /**
+     * Removing expired entries from the stash.
+     *
+     * @return Number of removed entries
+     */
+    size_t reclaimStash();
+
+    /**
+     * @return Kick chain over the table and stash of this filter, kicking tagged entries whole
+     */
+    inline KickChain<CuckooTable<entries_per_bucket, bits_per_slot, slot_type>, index_policy, codec> chain();
+
+    /**
+     * Insertion of tagged entry into bucket index with kicking, see KickChain::insert. Every bucket the
+     * kick chain reaches is reclaimed first.
+     *
+     * @param entry Tagged entry
+     * @param index Primary bucket of the entry
+     * @return Inserted or Stashed
+     */
+    InsertStatus insert(uint32_t entry, size_t index);
+
+    /**
+     * Moving a stashed entry back to the table after a slot in bucket index is freed. Expired stashed entries
+     * are removed first, the freed bucket may already be swept and must not receive them.
+     *
+     * @param index Index of bucket with a freed slot
+     */
+    void drainStash(size_t index);
+
+public:
+
+    /**
+     * @param max_table_size Maximum number of buckets, number of buckets is chosen by index_policy::tableSize
+     * @param stash_size Number of entries that can be stashed after failed insertions,
+     *                   between 1 and STASH_MAX_SIZE
+     * @param seed Hash seed, random by default
+     */
+    WindowedFilter(uint32_t max_table_size, size_t stash_size = STASH_DEFAULT_SIZE, uint64_t seed = randomSeed());
+
+    /**
+     * Destructor that is in charge of memory clean-up.
+     */
+    ~WindowedFilter();
+
+    /**
+     * Inserting element into the current generation.
+     *
+     * @param element Element for insertion
+     * @return True if element is inserted or stashed, false if it is rejected
+     */
+    template<typename key_type = element_type>
+    bool insertElement(const key_type &element);
+
+    /**
+     * Inserting element into the current generation and reporting where it ended up.
+     *
+     * @param element Element for insertion
+     * @param skip_present If true, element which is contained in a live generation is not inserted again
+     *                     and keeps its generation
+     * @return Outcome of the insertion
+     */
+    template<typename key_type = element_type>
+    InsertStatus tryInsertElement(const key_type &element, bool skip_present = false);
+
+    /**
+     * Inserting element only if it is not contained in a live generation, the usual deduplication call.
+     *
+     * @param element Element for insertion
+     * @return AlreadyPresent if element was contained, otherwise outcome of the insertion
+     */
+    template<typename key_type = element_type>
+    InsertStatus insertIfAbsent(const key_type &element);
+
+    /**
+     * Inserting element given by its precomputed 64-bit hash value and reporting where it ended up.
+     *
+     * @param hash_value Hash value of the element
+     * @param skip_present If true, element which is contained in a live generation is not inserted again
+     * @return Outcome of the insertion
+     */
+    InsertStatus tryInsertHash(uint64_t hash_value, bool skip_present = false);
+
+    /**
+     * Checking if element was inserted in a live generation.
+     *
+     * @param element Element to check
+     * @return True if item is contained
+     */
+    template<typename key_type = element_type>
+    bool containsElement(const key_type &element) const;
+
+    /**
+     * Checking if element given by its precomputed hash value was inserted in a live generation.
+     *
+     * @param hash_value Hash value of the element
+     * @return True if item is contained
+     */
+    bool containsHash(uint64_t hash_value) const;
+
+    /**
+     * Deleting live element before it expires.
+     *
+     * @param element Element for deletion
+     * @return True if item is deleted
+     */
+    template<typename key_type = element_type>
+    bool deleteElement(const key_type &element);
+
+    /**
+     * Reclaiming expired entries of the next max_buckets buckets. Once every bucket has been swept, the
+     * stash is reclaimed and further calls return 0 until the next advance.
+     *
+     * @param max_buckets Maximum number of buckets to sweep
+     * @return Number of reclaimed entries
+     */
+    size_t sweep(size_t max_buckets);
+
+    /**
+     * @return True if expired entries may still be left in buckets which were not swept yet
+     */
+    bool sweepPending() const;
+
+    /**
+     * Closing the current generation and starting a new one, the oldest live generation expires. Buckets
+     * which were not swept since the last advance are swept first.
+     *
+     * @return Number of reclaimed entries of the previously expired generation
+     */
+    size_t advance();
+
+    /**
+     * Retrieves tag of the current generation.
+     * @return generation tag, between 0 and 2^generation_bits - 1
+     */
+    uint32_t getGeneration() const;
+
+    /**
+     * Retrieves number of entries stored in the table, expired entries which are not reclaimed yet included
+     * and stashed entries not included.
+     * @return element count
+     */
+    size_t getElementCount();
+
+    /**
+     * Retrieves ratio of occupied entries.
+     * @return load factor between 0 and 1
+     */
+    double getLoadFactor();
+
+    /**
+     * Retrieves total number of buckets in the table.
+     * @return table size
+     */
+    size_t getTableSize();
+
+    /**
+     * Retrieves size of the table in bytes.
+     * @return table size in bytes
+     */
+    size_t getTableBytes();
+
+    /**
+     * Retrieves hash seed of the filter.
+     * @return hash seed
+     */
+    uint64_t getSeed();
+
+    /**
+     * Retrieves number of entries currently kept in the stash.
+     * @return stash size
+     */
+    size_t getStashSize();
+};
+
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+WindowedFilter(uint32_t max_table_size, size_t stash_size, uint64_t seed)
+        : index_policy_(index_policy::tableSize(max_table_size, entries_per_bucket), entries_per_bucket),
+          stash_(stash_size) {
+    if (stash_size == 0 || stash_size > STASH_MAX_SIZE) {
+        throw std::runtime_error("Invalid stash size, supported values are 1 to " +
+                                 std::to_string(STASH_MAX_SIZE) + ".\n");
+    }
+    if (max_table_size == 0) {
+        throw std::runtime_error("Table size must be positive.\n");
+    }
+    element_count_ = 0;
+    generation_ = 0;
+    expired_ = 1;
+    size_t table_size = index_policy::tableSize(max_table_size, entries_per_bucket);
+    // nothing has expired yet
+    sweep_cursor_ = table_size;
+
+    table_ = new CuckooTable<entries_per_bucket, bits_per_slot, slot_type>(table_size, codec::slot_mask);
+    hash_function_ = new HashFunction<hasher_type>(seed);
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+~WindowedFilter() {
+    delete table_;
+    delete hash_function_;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+void
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+firstPass(const uint64_t hash_value, uint32_t *fp, size_t *index) const {
+    *index = index_policy_.index(hash_value >> 32);
+    *fp = hash_value & codec::fp_mask;
+    // make sure that fingerprint != 0, free entries are 0
+    *fp += (*fp == 0);
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+size_t
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+indexComplement(const size_t index, const uint32_t entry) const {
+    return index_policy_.alternate(index, codec::fingerprint(entry));
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+bool
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+find(const uint32_t fp, const size_t i1, const size_t i2, uint32_t &entry, size_t &index, bool &stashed) const {
+    const uint32_t expired = expired_;
+    auto live = [expired](uint32_t candidate) { return codec::value(candidate) != expired; };
+
+    stashed = false;
+    if (table_->findEntry(i1, i2, fp, codec::fp_mask, live, entry, index)) {
+        return true;
+    }
+    for (size_t k = 0; k < stash_.size(); k++) {
+        Victim victim = stash_.get(k);
+        if (codec::fingerprint(victim.fp) == fp && (victim.index == i1 || victim.index == i2) && live(victim.fp)) {
+            entry = victim.fp;
+            index = k;
+            stashed = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+size_t
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+reclaim(const size_t i) {
+    const uint32_t expired = expired_;
+    size_t cleared = table_->clearEntries(i, [expired](uint32_t entry) { return codec::value(entry) == expired; });
+    this->element_count_ -= cleared;
+    for (size_t k = 0; k < cleared && !stash_.empty(); k++) {
+        drainStash(i);
+    }
+    return cleared;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+size_t
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+reclaimStash() {
+    size_t removed = 0;
+    for (size_t k = 0; k < stash_.size();) {
+        if (codec::value(stash_.get(k).fp) == expired_) {
+            // the last entry moves to position k, it is checked next
+            stash_.removeAt(k);
+            removed++;
+        } else {
+            k++;
+        }
+    }
+    return removed;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+KickChain<CuckooTable<entries_per_bucket, bits_per_slot, slot_type>, index_policy,
+          PayloadCodec<bits_per_slot, generation_bits>>
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+chain() {
+    return {*table_, index_policy_, stash_, element_count_};
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+InsertStatus
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+insert(const uint32_t entry, const size_t index) {
+    // an expired entry is a free one
+    return chain().insert(entry, index, true, [this](int, size_t i) {
+        reclaim(i);
+        return true;
+    });
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+void
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+drainStash(const size_t index) {
+    reclaimStash();
+    // no reinsertion with kicking, it would reclaim further buckets and drain the stash into them again
+    chain().drainStash(index, false);
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+template<typename key_type>
+bool
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+insertElement(const key_type &element) {
+    return tryInsertElement(element) != InsertStatus::RejectedFull;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+template<typename key_type>
+InsertStatus
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+tryInsertElement(const key_type &element, const bool skip_present) {
+    return tryInsertHash(hash_function_->hash(element), skip_present);
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+template<typename key_type>
+InsertStatus
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+insertIfAbsent(const key_type &element) {
+    return tryInsertHash(hash_function_->hash(element), true);
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+InsertStatus
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+tryInsertHash(const uint64_t hash_value, const bool skip_present) {
+    size_t index;
+    uint32_t fp;
+
+    CF_STATS(StatsRegistry::local().insertions++);
+
+    // lazy reclamation runs ahead of the insertion, so the expiring generation is gone before advance
+    sweep(WINDOW_SWEEP_STEP);
+
+    // a failed kick chain could not be stashed
+    if (stash_.full() && reclaimStash() == 0) {
+        CF_STATS(StatsRegistry::local().rejected++);
+        return InsertStatus::RejectedFull;
+    }
+
+    firstPass(hash_value, &fp, &index);
+
+    if (skip_present) {
+        uint32_t entry;
+        size_t holder;
+        bool stashed;
+        if (find(fp, index, indexComplement(index, fp), entry, holder, stashed)) {
+            return InsertStatus::AlreadyPresent;
+        }
+    }
+
+    return this->insert(codec::encode(fp, generation_), index);
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+template<typename key_type>
+bool
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+containsElement(const key_type &element) const {
+    return containsHash(hash_function_->hash(element));
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+bool
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+containsHash(const uint64_t hash_value) const {
+    uint32_t fp;
+    size_t i1;
+    uint32_t entry;
+    size_t holder;
+    bool stashed;
+
+    CF_STATS(StatsRegistry::local().lookups++);
+
+    firstPass(hash_value, &fp, &i1);
+    bool found = find(fp, i1, indexComplement(i1, fp), entry, holder, stashed);
+    CF_STATS(StatsRegistry::local().lookup_hits += found; StatsRegistry::local().stash_hits += stashed);
+    return found;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+template<typename key_type>
+bool
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+deleteElement(const key_type &element) {
+    uint32_t fp;
+    size_t i1;
+    uint32_t entry;
+    size_t holder;
+    bool stashed;
+
+    CF_STATS(StatsRegistry::local().deletions++);
+
+    firstPass(hash_function_->hash(element), &fp, &i1);
+    if (!find(fp, i1, indexComplement(i1, fp), entry, holder, stashed)) {
+        return false;
+    }
+    CF_STATS(StatsRegistry::local().deletion_hits++);
+    if (stashed) {
+        stash_.removeAt(holder);
+        return true;
+    }
+    table_->deleteFingerprint(entry, holder);
+    this->element_count_--;
+    if (!stash_.empty()) {
+        drainStash(holder);
+    }
+    return true;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+size_t
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+sweep(const size_t max_buckets) {
+    const size_t table_size = table_->getTableSize();
+    if (sweep_cursor_ == table_size) {
+        return 0;
+    }
+    size_t reclaimed = 0;
+    size_t end = std::min(table_size, sweep_cursor_ + max_buckets);
+    for (; sweep_cursor_ < end; sweep_cursor_++) {
+        reclaimed += reclaim(sweep_cursor_);
+    }
+    if (sweep_cursor_ == table_size) {
+        reclaimed += reclaimStash();
+    }
+    return reclaimed;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+bool
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+sweepPending() const {
+    return sweep_cursor_ != table_->getTableSize();
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+size_t
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+advance() {
+    // the expired tag becomes the next generation's tag, none of its entries may be left
+    size_t reclaimed = sweep(table_->getTableSize());
+    generation_ = expired_;
+    expired_ = (generation_ + 1) & codec::value_mask;
+    sweep_cursor_ = 0;
+    return reclaimed;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+uint32_t
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+getGeneration() const {
+    return generation_;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+size_t
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+getElementCount() {
+    return this->element_count_;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+double
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+getLoadFactor() {
+    return this->element_count_ / ((double) this->table_->maxNoOfElements());
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+size_t
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+getTableSize() {
+    return this->table_->getTableSize();
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+size_t
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+getTableBytes() {
+    return this->table_->getTableSize() * entries_per_bucket * bits_per_slot / 8;
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+uint64_t
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+getSeed() {
+    return this->hash_function_->getSeed();
+}
+
+
+template<typename element_type, size_t entries_per_bucket, size_t bits_per_slot, typename slot_type,
+         size_t generation_bits, typename hasher_type, typename index_policy>
+size_t
+WindowedFilter<element_type, entries_per_bucket, bits_per_slot, slot_type, generation_bits, hasher_type, index_policy>::
+getStashSize() {
+    return this->stash_.size();
+}
+
+#endif